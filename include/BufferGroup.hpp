@@ -0,0 +1,152 @@
+#pragma once
+
+#include "DoubleBuffer.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace yy {
+/**
+ * Several related values (e.g. symbols, limits, routing) published together.
+ *
+ * Each version of the group is a set of shared pointers, one per member,
+ * kept in a single DoubleBuffer. A publish swaps the whole set at once, so
+ * readers never see members from different versions, and pinning the set
+ * is one reference count operation however many members a reader touches.
+ * Members a publish leaves alone are shared with the previous version
+ * instead of being copied.
+ */
+template <typename... Ts> class BufferGroup {
+  static_assert(sizeof...(Ts) > 0, "BufferGroup needs at least one member");
+
+private:
+  using Set = std::tuple<std::shared_ptr<const Ts>...>;
+
+  template <std::size_t I>
+  using Member = std::tuple_element_t<I, std::tuple<Ts...>>;
+
+  DoubleBuffer<Set> buffer_;
+  // Latest published set (single writer)
+  Set latest_;
+
+public:
+  /**
+   * Consistent view of every member of one version, pinned until the view
+   * is destroyed. Must not outlive the BufferGroup.
+   */
+  class View {
+  public:
+    View() = default;
+
+    template <std::size_t I> const Member<I> &get() const noexcept {
+      return *std::get<I>(*snapshot_);
+    }
+
+    // Number of group publishes before this version
+    std::uint64_t generation() const noexcept {
+      return snapshot_.generation();
+    }
+
+    explicit operator bool() const noexcept {
+      return static_cast<bool>(snapshot_);
+    }
+
+  private:
+    friend class BufferGroup;
+    explicit View(typename DoubleBuffer<Set>::Snapshot snapshot) noexcept
+        : snapshot_(std::move(snapshot)) {}
+
+    typename DoubleBuffer<Set>::Snapshot snapshot_;
+  };
+
+  /**
+   * Staged changes of one publish(), see BufferGroup::publish
+   */
+  class Transaction {
+  public:
+    template <std::size_t I> void set(Member<I> value) {
+      std::get<I>(next_) = std::make_shared<const Member<I>>(std::move(value));
+    }
+
+    // Applies mutator to a copy of member I as staged so far
+    template <std::size_t I, typename Mutator> void update(Mutator &&mutator) {
+      Member<I> value = *std::get<I>(next_);
+      mutator(value);
+      set<I>(std::move(value));
+    }
+
+    // Member I as staged so far
+    template <std::size_t I> const Member<I> &get() const noexcept {
+      return *std::get<I>(next_);
+    }
+
+  private:
+    friend class BufferGroup;
+    explicit Transaction(const Set &current) : next_(current) {}
+
+    Set next_;
+  };
+
+  explicit BufferGroup(const Ts &...init_values)
+      : buffer_(Set(std::make_shared<const Ts>(init_values)...)),
+        latest_(buffer_.read()) {}
+
+  BufferGroup(const BufferGroup &) = delete;
+  BufferGroup &operator=(const BufferGroup &) = delete;
+
+  /**
+   * @brief Pins the current version of all members with a single acquire
+   *        (thread-safe for multiple readers)
+   */
+  View pin() const noexcept { return View(buffer_.snapshot()); }
+
+  /**
+   * @brief Calls visitor(const Ts &...) on one consistent version, without
+   *        copying (thread-safe for multiple readers)
+   */
+  template <typename Visitor> decltype(auto) visit(Visitor &&visitor) const {
+    return buffer_.visit([&visitor](const Set &set) -> decltype(auto) {
+      return std::apply(
+          [&visitor](const auto &...members) -> decltype(auto) {
+            return visitor(*members...);
+          },
+          set);
+    });
+  }
+
+  // Copy of member I (thread-safe for multiple readers)
+  template <std::size_t I> Member<I> read() const {
+    return buffer_.visit(
+        [](const Set &set) -> Member<I> { return *std::get<I>(set); });
+  }
+
+  /**
+   * @brief Stages changes with f(Transaction &) and publishes all of them in
+   *        one flip (single writer thread only)
+   */
+  template <typename F> void publish(F &&f) {
+    Transaction transaction(latest_);
+    f(transaction);
+    latest_ = std::move(transaction.next_);
+    buffer_.write(latest_);
+  }
+
+  // Publishes a new value for member I alone (single writer thread only)
+  template <std::size_t I> void write(Member<I> value) {
+    publish([&value](Transaction &t) { t.template set<I>(std::move(value)); });
+  }
+
+  std::uint64_t generation() const noexcept { return buffer_.generation(); }
+
+  // Whether member I of a and b is the same object, i.e. was not republished
+  // in between
+  template <std::size_t I>
+  static bool shares(const View &a, const View &b) noexcept {
+    return std::get<I>(*a.snapshot_) == std::get<I>(*b.snapshot_);
+  }
+};
+} // namespace yy
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace yy {
+/**
+ * Persistent vector made of fixed-size, reference counted chunks with
+ * copy-on-write. Copying it only copies the chunk table, and a mutation
+ * clones just the chunk it touches.
+ *
+ * Used as DoubleBuffer<ChunkedVector<U>>, the two buffers share every chunk
+ * that did not change, so a large table costs about one copy plus the
+ * delta instead of two full copies. Publish with update(), which copies the
+ * table from the current version and lets the mutator touch only what
+ * changes. Readers should prefer visit() or snapshot(), read() copies the
+ * table and bumps every chunk's count.
+ */
+template <typename U,
+          std::size_t ChunkSize = std::max<std::size_t>(1, 4096 / sizeof(U))>
+class ChunkedVector {
+private:
+  using Chunk = std::array<U, ChunkSize>;
+
+  std::vector<std::shared_ptr<Chunk>> chunks_;
+  std::size_t size_{0};
+
+public:
+  static constexpr std::size_t chunk_size = ChunkSize;
+
+  ChunkedVector() = default;
+
+  ChunkedVector(std::size_t count, const U &value) : size_(count) {
+    chunks_.reserve((count + ChunkSize - 1) / ChunkSize);
+    for (std::size_t i = 0; i < count; i += ChunkSize) {
+      auto chunk = std::make_shared<Chunk>();
+      chunk->fill(value);
+      chunks_.push_back(std::move(chunk));
+    }
+  }
+
+  std::size_t size() const noexcept { return size_; }
+  bool empty() const noexcept { return size_ == 0; }
+
+  const U &operator[](std::size_t i) const noexcept {
+    return (*chunks_[i / ChunkSize])[i % ChunkSize];
+  }
+
+  /**
+   * @brief Mutable access, clones the chunk first if another version
+   *        shares it (single writer only)
+   */
+  U &mutable_at(std::size_t i) {
+    return (*own(i / ChunkSize))[i % ChunkSize];
+  }
+
+  void set(std::size_t i, const U &value) { mutable_at(i) = value; }
+
+  void push_back(const U &value) {
+    if (size_ % ChunkSize == 0) {
+      chunks_.push_back(std::make_shared<Chunk>());
+    }
+    ++size_;
+    mutable_at(size_ - 1) = value;
+  }
+
+  // Number of chunks this version shares with other
+  std::size_t shared_chunks(const ChunkedVector &other) const noexcept {
+    std::size_t shared = 0;
+    const std::size_t n = std::min(chunks_.size(), other.chunks_.size());
+    for (std::size_t c = 0; c < n; ++c) {
+      shared += chunks_[c] == other.chunks_[c];
+    }
+    return shared;
+  }
+
+  std::size_t chunk_count() const noexcept { return chunks_.size(); }
+
+  friend bool operator==(const ChunkedVector &a, const ChunkedVector &b) {
+    if (a.size_ != b.size_) {
+      return false;
+    }
+    for (std::size_t i = 0; i < a.size_; ++i) {
+      if (!(a[i] == b[i])) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+private:
+  Chunk *own(std::size_t c) {
+    std::shared_ptr<Chunk> &chunk = chunks_[c];
+    if (chunk.use_count() != 1) {
+      chunk = std::make_shared<Chunk>(*chunk);
+    } else {
+      // Pairs with the release of the last other owner, whose reads of the
+      // chunk must finish before we write to it
+      std::atomic_thread_fence(std::memory_order_acquire);
+    }
+    return chunk.get();
+  }
+};
+} // namespace yy
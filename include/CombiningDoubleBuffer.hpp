@@ -0,0 +1,137 @@
+#pragma once
+
+#include "DoubleBuffer.hpp"
+
+#include <atomic>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace yy {
+/**
+ * Multi-writer front end for DoubleBuffer based on flat combining.
+ *
+ * Writers post their request to a lock-free publication list. Whichever
+ * writer grabs the combiner role applies every pending request to the back
+ * buffer and publishes them with a single swap, so a burst of N writers
+ * pays for one reader drain instead of N.
+ */
+template <typename T> class CombiningDoubleBuffer {
+private:
+  // Lives on the stack of the posting writer until `done` is set
+  struct Request {
+    void (*apply)(T &, void *);
+    void *context;
+    // True when the request overwrites the whole value
+    bool replaces;
+    Request *next{nullptr};
+    std::atomic<bool> done{false};
+  };
+
+  DoubleBuffer<T> buffer_;
+
+  // Publication list, most recent request first
+  std::atomic<Request *> pending_{nullptr};
+
+  // Held by the thread currently acting as combiner
+  std::atomic<bool> combining_{false};
+
+public:
+  explicit CombiningDoubleBuffer(const T &init_value) : buffer_(init_value) {}
+
+  CombiningDoubleBuffer(const CombiningDoubleBuffer &) = delete;
+  CombiningDoubleBuffer &operator=(const CombiningDoubleBuffer &) = delete;
+
+  /**
+   * @brief Reads the current value (thread-safe for multiple readers)
+   * @return Copy of the stored data
+   */
+  T read() const noexcept { return buffer_.read(); }
+
+  /**
+   * @brief Replaces the stored value (thread-safe for multiple writers)
+   * @param new_value The new value to store
+   */
+  void write(const T &new_value) noexcept {
+    Request request{
+        [](T &data, void *context) { data = *static_cast<const T *>(context); },
+        const_cast<T *>(&new_value), true};
+    submit(request);
+  }
+
+  /**
+   * @brief Applies a mutation to the current value (thread-safe for multiple
+   *        writers). Mutations are applied in the order they were posted.
+   * @param mutator Callable invoked as mutator(T&), must not throw
+   */
+  template <typename Mutator> void update(Mutator &&mutator) noexcept {
+    using M = std::remove_reference_t<Mutator>;
+    Request request{
+        [](T &data, void *context) { (*static_cast<M *>(context))(data); },
+        const_cast<void *>(static_cast<const void *>(&mutator)), false};
+    submit(request);
+  }
+
+private:
+  void submit(Request &request) noexcept {
+    // Post the request to the publication list
+    Request *head = pending_.load(std::memory_order_relaxed);
+    do {
+      request.next = head;
+    } while (!pending_.compare_exchange_weak(head, &request,
+                                             std::memory_order_release,
+                                             std::memory_order_relaxed));
+
+    // Wait for a combiner to serve us, or become the combiner
+    while (!request.done.load(std::memory_order_acquire)) {
+      if (!combining_.exchange(true, std::memory_order_acquire)) {
+        combine();
+        combining_.store(false, std::memory_order_release);
+      } else {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  void combine() noexcept {
+    Request *batch = pending_.exchange(nullptr, std::memory_order_acquire);
+    if (batch == nullptr) {
+      return;
+    }
+
+    // Reverse into posting order, remembering the last full replacement:
+    // everything posted before it is overwritten anyway
+    Request *ordered = nullptr;
+    Request *last_replace = nullptr;
+    while (batch != nullptr) {
+      Request *next = batch->next;
+      if (batch->replaces && last_replace == nullptr) {
+        last_replace = batch;
+      }
+      batch->next = ordered;
+      ordered = batch;
+      batch = next;
+    }
+
+    auto apply_from = [](T &data, Request *first) {
+      for (Request *r = first; r != nullptr; r = r->next) {
+        r->apply(data, r->context);
+      }
+    };
+    if (last_replace != nullptr) {
+      // No need to copy the current value into the back buffer
+      buffer_.write_with(
+          [&](T &data) { apply_from(data, last_replace); });
+    } else {
+      buffer_.update([&](T &data) { apply_from(data, ordered); });
+    }
+
+    // Release the writers; a request may vanish as soon as it is done
+    while (ordered != nullptr) {
+      Request *next = ordered->next;
+      ordered->done.store(true, std::memory_order_release);
+      ordered = next;
+    }
+  }
+};
+} // namespace yy
@@ -1,20 +1,318 @@
+#pragma once
+
+#include "StreamCopy.hpp"
+
+#include <algorithm>
+#include <array>
 #include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <system_error>
 #include <thread>
 #include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <ctime>
+
+#include <linux/futex.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// co_await next_update() needs C++20 coroutines
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+#define YY_HAS_COROUTINES 1
+#endif
 
 namespace yy {
-template <typename T> class DoubleBuffer {
-  static_assert(std::is_copy_constructible_v<T>,
-                "T must be copy constructible");
+// std::hardware_destructive_interference_size changes with -mtune, which
+// would make the layout differ between translation units, so default to the
+// common x86/ARM line size and let builds override it
+#if defined(YY_CACHE_LINE_SIZE)
+constexpr std::size_t kCacheLineSize = YY_CACHE_LINE_SIZE;
+#else
+constexpr std::size_t kCacheLineSize = 64;
+#endif
+
+// Storage policies
+// Two reference counted buffers (any copyable T). Buffers are aligned to
+// Alignment, use 128 where the adjacent-line prefetcher pulls line pairs.
+// With IsolateCounters the reader-modified counters get their own
+// Alignment-sized line instead of sharing one with the tail of T.
+template <std::size_t Alignment = kCacheLineSize, bool IsolateCounters = false>
+struct BufferedLayout {
+  static_assert((Alignment & (Alignment - 1)) == 0 &&
+                    Alignment >= alignof(std::atomic<unsigned>),
+                "Alignment must be a power of two");
+  static constexpr std::size_t alignment = Alignment;
+  static constexpr bool isolate_counters = IsolateCounters;
+};
+using Buffered = BufferedLayout<>;
+template <std::size_t Alignment = kCacheLineSize>
+using Isolated = BufferedLayout<Alignment, true>;
+
+// One lock-free std::atomic<T>, for small trivially copyable T. With
+// CountWrites each write also bumps a generation counter, which enables
+// generation() and wait_for_update() at the cost of more atomics per write.
+template <bool CountWrites = false> struct SingleAtomicLayout {};
+using SingleAtomic = SingleAtomicLayout<>;
+using CountedAtomic = SingleAtomicLayout<true>;
+// Two buffers holding heap-allocated T swapped by pointer, for move-only or
+// non-movable T
+struct Indirect {
+  static constexpr std::size_t alignment = kCacheLineSize;
+  static constexpr bool isolate_counters = false;
+};
+
+// Byte range inside a trivially copyable T, see DoubleBuffer::write_ranges
+struct ByteRange {
+  std::size_t offset;
+  std::size_t length;
+};
+
+/**
+ * @brief Range covering count consecutive members starting at member of
+ *        object, e.g. byte_range(prices, prices.bid[10], 4)
+ */
+template <typename T, typename M>
+ByteRange byte_range(const T &object, const M &member,
+                     std::size_t count = 1) noexcept {
+  return {static_cast<std::size_t>(reinterpret_cast<const char *>(&member) -
+                                   reinterpret_cast<const char *>(&object)),
+          sizeof(M) * count};
+}
+
+namespace detail {
+// Sleeps while word holds expected, at most timeout (null: no limit).
+// Without futexes it naps briefly and lets the caller re-check.
+inline void futex_wait(const std::atomic<std::uint32_t> &word,
+                       std::uint32_t expected,
+                       const std::chrono::nanoseconds *timeout) noexcept {
+#if defined(__linux__)
+  timespec ts{};
+  if (timeout != nullptr) {
+    ts.tv_sec = static_cast<std::time_t>(timeout->count() / 1000000000);
+    ts.tv_nsec = static_cast<long>(timeout->count() % 1000000000);
+  }
+  ::syscall(SYS_futex, &word, FUTEX_WAIT_PRIVATE, expected,
+            timeout != nullptr ? &ts : nullptr, nullptr, 0);
+#else
+  std::chrono::nanoseconds nap = std::chrono::milliseconds(1);
+  if (timeout != nullptr && *timeout < nap) {
+    nap = *timeout;
+  }
+  if (word.load(std::memory_order_relaxed) == expected) {
+    std::this_thread::sleep_for(nap);
+  }
+#endif
+}
+
+// Distinguishes DoubleBuffer instances in thread-local caches, where an
+// address could be reused by a later instance
+inline std::uint64_t next_instance_id() noexcept {
+  static std::atomic<std::uint64_t> next{1};
+  return next.fetch_add(1, std::memory_order_relaxed);
+}
+
+inline void futex_wake_all(const std::atomic<std::uint32_t> &word) noexcept {
+#if defined(__linux__)
+  ::syscall(SYS_futex, &word, FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr,
+            0);
+#else
+  (void)word;
+#endif
+}
+
+// steady_clock::now() + timeout, saturated at time_point::max() so that
+// e.g. hours::max() waits forever instead of overflowing
+template <typename Rep, typename Period>
+std::chrono::steady_clock::time_point
+deadline_after(std::chrono::duration<Rep, Period> timeout) noexcept {
+  using Clock = std::chrono::steady_clock;
+  const Clock::time_point now = Clock::now();
+  // Compared in floating point, converting timeout to ticks could overflow
+  if (std::chrono::duration<double>(timeout) >=
+      std::chrono::duration<double>(Clock::time_point::max() - now)) {
+    return Clock::time_point::max();
+  }
+  return now + std::chrono::ceil<Clock::duration>(timeout);
+}
+
+// Publish counter readers can sleep on, see DoubleBuffer::wait_for_update
+struct UpdateSignal {
+  // Number of publishes so far, stored by the writer
+  std::atomic<std::uint64_t> generation{0};
+  // Bumped on every publish for sleepers, which count themselves in
+  // waiters so that the writer only wakes when needed
+  std::atomic<std::uint32_t> wake_word{0};
+  std::atomic<std::uint32_t> waiters{0};
+
+  // Announces the next generation (single writer)
+  void publish() noexcept {
+    // Sequentially consistent, so a sleeper either sees the new generation
+    // or is counted in waiters (see wait_until_newer)
+    generation.store(generation.load(std::memory_order_relaxed) + 1,
+                     std::memory_order_seq_cst);
+    wake_word.fetch_add(1, std::memory_order_seq_cst);
+    if (waiters.load(std::memory_order_seq_cst) != 0) {
+      futex_wake_all(wake_word);
+    }
+  }
+
+  // Wakes every sleeper without a new generation
+  void wake_all() noexcept {
+    wake_word.fetch_add(1, std::memory_order_seq_cst);
+    futex_wake_all(wake_word);
+  }
+
+  // Sleeps until the next publish after word was loaded from wake_word
+  void sleep(std::uint32_t word,
+             const std::chrono::nanoseconds *timeout) noexcept {
+    // A publish after the load of word changes it, so the futex does not
+    // sleep; one after this increment sees us and wakes the futex
+    waiters.fetch_add(1, std::memory_order_seq_cst);
+    futex_wait(wake_word, word, timeout);
+    waiters.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  std::uint64_t wait_until_newer(
+      std::uint64_t seen_generation,
+      const std::chrono::steady_clock::time_point *deadline) noexcept {
+    while (true) {
+      const std::uint32_t word = wake_word.load(std::memory_order_seq_cst);
+      const std::uint64_t current =
+          generation.load(std::memory_order_seq_cst);
+      if (current > seen_generation) {
+        return current;
+      }
+      std::chrono::nanoseconds left{};
+      if (deadline != nullptr) {
+        const auto now = std::chrono::steady_clock::now();
+        if (now >= *deadline) {
+          return current;
+        }
+        left = *deadline - now;
+      }
+      sleep(word, deadline != nullptr ? &left : nullptr);
+    }
+  }
+};
+
+// Intrusive list node of a coroutine suspended in next_update()
+struct UpdateWaiter {
+  UpdateWaiter *next{nullptr};
+  std::uint64_t seen{0};
+  // Set by the writer before wake runs
+  std::uint64_t generation{0};
+  void (*wake)(UpdateWaiter &) noexcept {nullptr};
+};
+
+#if defined(YY_HAS_COROUTINES)
+// Default next_update() executor: resume on the publishing thread
+struct ResumeInline {
+  void operator()(std::coroutine_handle<> handle) const { handle.resume(); }
+};
+#endif
+
+// Write counter of CountedAtomic buffers, empty otherwise
+template <bool CountWrites> struct AtomicWriteCounter {};
+template <> struct AtomicWriteCounter<true> {
+  mutable UpdateSignal signal;
+};
+
+template <typename Storage> struct is_single_atomic : std::false_type {};
+template <bool CountWrites>
+struct is_single_atomic<SingleAtomicLayout<CountWrites>> : std::true_type {};
+
+template <typename Storage> struct is_buffered_layout : std::false_type {};
+template <std::size_t Alignment, bool IsolateCounters>
+struct is_buffered_layout<BufferedLayout<Alignment, IsolateCounters>>
+    : std::true_type {};
+
+// std::atomic<T> also needs T copyable and movable, which C++20 checks
+template <typename T, bool = std::is_trivially_copyable_v<T> &&
+                             std::is_copy_constructible_v<T> &&
+                             std::is_move_constructible_v<T> &&
+                             std::is_copy_assignable_v<T> &&
+                             std::is_move_assignable_v<T>>
+struct fits_single_atomic : std::false_type {};
+// 16-byte T only qualifies where the compiler inlines cmpxchg16b
+template <typename T>
+struct fits_single_atomic<T, true>
+    : std::bool_constant<std::atomic<T>::is_always_lock_free> {};
+
+// C++17 stand-in for std::uninitialized_construct_using_allocator
+template <typename T, typename Alloc, typename... Args>
+T *construct_using_allocator(T *p, const Alloc &alloc, Args &&...args) {
+  if constexpr (!std::uses_allocator_v<T, Alloc>) {
+    return ::new (static_cast<void *>(p)) T(std::forward<Args>(args)...);
+  } else if constexpr (std::is_constructible_v<T, std::allocator_arg_t,
+                                               const Alloc &, Args...>) {
+    return ::new (static_cast<void *>(p))
+        T(std::allocator_arg, alloc, std::forward<Args>(args)...);
+  } else {
+    return ::new (static_cast<void *>(p)) T(std::forward<Args>(args)..., alloc);
+  }
+}
+} // namespace detail
+
+template <typename T>
+using default_storage_t = std::conditional_t<
+    detail::fits_single_atomic<T>::value, SingleAtomic,
+    std::conditional_t<std::is_copy_constructible_v<T>, Buffered, Indirect>>;
+
+template <typename T, typename Storage = default_storage_t<T>>
+class DoubleBuffer {
+  static_assert(detail::is_buffered_layout<Storage>::value ||
+                    std::is_same_v<Storage, Indirect>,
+                "Unknown DoubleBuffer storage policy");
+  static_assert(std::is_same_v<Storage, Indirect> ||
+                    std::is_copy_constructible_v<T>,
+                "T must be copy constructible, or use Indirect storage");
+
+  static constexpr bool kIndirect = std::is_same_v<Storage, Indirect>;
+  using Slot = std::conditional_t<kIndirect, std::unique_ptr<T>, T>;
 
 private:
-  // Buffer structure with padding (64 bytes) to prevent false sharing
-  struct alignas(64) Buffer {
-    T data;
+  static constexpr std::size_t kCounterAlignment =
+      Storage::isolate_counters ? Storage::alignment
+                                : alignof(std::atomic<unsigned>);
+
+  // Buffer structure with padding (64 bytes by default) to prevent false
+  // sharing
+  struct alignas(Storage::alignment) Buffer {
+    // Per-buffer arena when constructed with a memory_resource, declared
+    // first so it outlives data
+    std::unique_ptr<std::pmr::monotonic_buffer_resource> arena;
+    Slot data;
     // Mutable allows modification in const method
     // conceptionally, since data is not changed, read() can be a const method
     // but we need to modify ref_count, so it must be mutable
-    mutable std::atomic<unsigned> ref_count{0};
+    alignas(kCounterAlignment) mutable std::atomic<unsigned> ref_count{0};
+    // Outstanding Snapshot handles, they don't block the writer
+    mutable std::atomic<unsigned> snapshot_count{0};
+    // Publish count of the version held in data (written by the writer)
+    std::uint64_t generation{0};
+    // When that version was published, construction for the initial value
+    std::chrono::steady_clock::time_point published{
+        std::chrono::steady_clock::now()};
   };
 
   // Double buffer storage, 2 copies.
@@ -26,22 +324,795 @@ private:
   // Non-atomic write index (single writer)
   Buffer *write_buffer_{&buffers_[1]};
 
+  // Upstream of the per-buffer arenas, null for the global heap
+  std::pmr::memory_resource *upstream_{nullptr};
+
+  // Where heap slots are allocated, null for the global heap
+  std::pmr::memory_resource *slot_resource_{nullptr};
+
+  // Generation, bumped by the writer after each swap, and its sleepers
+  alignas(kCacheLineSize) mutable detail::UpdateSignal signal_;
+
+  // Ranges changed by the last publish, valid while dirty_generation_
+  // matches the current version (single writer)
+  std::vector<ByteRange> last_dirty_;
+  std::uint64_t dirty_generation_{~std::uint64_t{0}};
+
+  // Buffers taken out of rotation while snapshots still pin them, and
+  // spares that can re-enter it (single writer). Heap slots stay here until
+  // the DoubleBuffer dies: a reader that loaded read_buffer_ just before a
+  // swap may still bump the reference count of a retired slot.
+  std::vector<Buffer *> retired_;
+
+  // Key of this instance in read_stale_ok() caches
+  const std::uint64_t instance_id_{detail::next_instance_id()};
+
+  // Publish observers, allocated by the first subscribe()
+  struct Observers;
+  std::atomic<Observers *> observers_{nullptr};
+
 public:
+  /**
+   * Shared-ownership handle to one published version. The writer never
+   * waits for it: a pinned buffer is swapped out of rotation for a heap
+   * slot instead, and heap slots are reused rather than freed. Must not
+   * outlive the DoubleBuffer.
+   */
+  class Snapshot {
+  public:
+    Snapshot() = default;
+    Snapshot(const Snapshot &other) noexcept : buffer_(other.buffer_) {
+      if (buffer_ != nullptr) {
+        buffer_->snapshot_count.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+    Snapshot(Snapshot &&other) noexcept
+        : buffer_(std::exchange(other.buffer_, nullptr)),
+          counted_(other.counted_) {}
+    Snapshot &operator=(Snapshot other) noexcept {
+      std::swap(buffer_, other.buffer_);
+      std::swap(counted_, other.counted_);
+      return *this;
+    }
+    ~Snapshot() {
+      if (buffer_ != nullptr && counted_) {
+        buffer_->snapshot_count.fetch_sub(1, std::memory_order_release);
+      }
+    }
+
+    const T &operator*() const noexcept { return value_of(*buffer_); }
+    const T *operator->() const noexcept { return &value_of(*buffer_); }
+    explicit operator bool() const noexcept { return buffer_ != nullptr; }
+
+    // Generation of the pinned version
+    std::uint64_t generation() const noexcept { return buffer_->generation; }
+
+    // When the pinned version was published
+    std::chrono::steady_clock::time_point published() const noexcept {
+      return buffer_->published;
+    }
+
+  private:
+    friend class DoubleBuffer;
+    // Takes over a snapshot_count increment
+    explicit Snapshot(const Buffer *buffer) noexcept : buffer_(buffer) {}
+
+    // View handed to observers while the buffer is pinned by other means;
+    // copies of it are counted as usual
+    struct Borrowed {};
+    Snapshot(const Buffer *buffer, Borrowed) noexcept
+        : buffer_(buffer), counted_(false) {}
+
+    const Buffer *buffer_{nullptr};
+    bool counted_{true};
+  };
+
   // Must provide init value for T
   explicit DoubleBuffer(const T &init_value) {
-    buffers_[0].data = init_value;
-    buffers_[1].data = init_value;
+    if constexpr (kIndirect) {
+      buffers_[0].data = std::make_unique<T>(init_value);
+    } else {
+      buffers_[0].data = init_value;
+      buffers_[1].data = init_value;
+    }
+  }
+
+  // Indirect storage only, takes ownership of the initial object. Left out
+  // of overload resolution otherwise, so DoubleBuffer<T>({}) still works.
+  template <bool Indirect = kIndirect, std::enable_if_t<Indirect, int> = 0>
+  explicit DoubleBuffer(std::unique_ptr<T> init_value) {
+    buffers_[0].data = std::move(init_value);
+  }
+
+  /**
+   * @brief Gives every buffer its own arena on top of upstream. Allocator
+   *        aware T (pmr containers) allocate from the arena of the buffer
+   *        they live in, and write()/update() reset that arena wholesale
+   *        before rebuilding. In-place write_with() fills keep allocating
+   *        from it until the next reset. (Buffered storage only)
+   * @param upstream Resource the arenas take their chunks from, must
+   *        outlive the DoubleBuffer
+   */
+  DoubleBuffer(const T &init_value, std::pmr::memory_resource *upstream)
+      : upstream_(upstream) {
+    static_assert(!kIndirect, "Arenas need Buffered storage");
+    for (Buffer &buffer : buffers_) {
+      buffer.arena =
+          std::make_unique<std::pmr::monotonic_buffer_resource>(upstream_);
+      rebuild(buffer, init_value);
+    }
   }
 
   // Disallow copy
   DoubleBuffer(const DoubleBuffer &) = delete;
   DoubleBuffer &operator=(const DoubleBuffer &) = delete;
 
+  /**
+   * @brief Allocates the heap slots that pinned buffers are rotated out for
+   *        from resource, e.g. to keep a large inline T in huge pages. Call
+   *        before the first write.
+   * @param resource Must outlive the DoubleBuffer
+   */
+  void use_slot_resource(std::pmr::memory_resource *resource) noexcept {
+    assert(retired_.empty() && !is_heap(write_buffer_) &&
+           "use_slot_resource() after heap slots were created");
+    slot_resource_ = resource;
+  }
+
+  ~DoubleBuffer() {
+    if (Observers *observers = observers_.load(std::memory_order_acquire)) {
+      stop_notifier(*observers);
+      delete observers;
+    }
+    release_if_heap(write_buffer_);
+    release_if_heap(read_buffer_.load(std::memory_order_relaxed));
+    for (Buffer *buffer : retired_) {
+      release_if_heap(buffer);
+    }
+  }
+
   /**
    * @brief Reads the current value (thread-safe for multiple readers)
    * @return Copy of the stored data
    */
   T read() const noexcept {
+    static_assert(std::is_copy_constructible_v<T>,
+                  "read() copies T, use visit() or snapshot()");
+    const Buffer *read_ptr = acquire();
+
+    // Copy the data to return
+    T value = value_of(*read_ptr);
+
+    // Decrement reference count when done
+    read_ptr->ref_count.fetch_sub(1, std::memory_order_release);
+
+    return value;
+  }
+
+  /**
+   * @brief Returns a copy cached per thread, refreshed with read() once it
+   *        is max_age old. Within max_age this touches no shared memory, so
+   *        consumers that tolerate bounded staleness skip the reference
+   *        count traffic on most calls. (thread-safe for multiple readers)
+   * @return Reference to the calling thread's copy, valid until its next
+   *         read_stale_ok() on a DoubleBuffer of the same type
+   */
+  const T &
+  read_stale_ok(std::chrono::steady_clock::duration max_age) const {
+    static_assert(std::is_copy_constructible_v<T>,
+                  "read_stale_ok() copies T, use visit() or snapshot()");
+    // A few entries per thread, so one thread can poll several buffers
+    struct Entry {
+      std::uint64_t owner{0};
+      std::chrono::steady_clock::time_point fetched;
+      std::optional<T> value;
+    };
+    static thread_local Entry cache[4];
+    static thread_local std::size_t victim = 0;
+
+    const auto now = std::chrono::steady_clock::now();
+    Entry *entry = nullptr;
+    for (Entry &candidate : cache) {
+      if (candidate.owner == instance_id_) {
+        entry = &candidate;
+        break;
+      }
+    }
+    if (entry == nullptr) {
+      entry = &cache[victim];
+      victim = (victim + 1) % std::size(cache);
+      entry->owner = instance_id_;
+    } else if (now - entry->fetched < max_age) {
+      return *entry->value;
+    }
+    entry->value.emplace(read());
+    entry->fetched = now;
+    return *entry->value;
+  }
+
+  /**
+   * @brief Invokes a visitor on the current value without copying it
+   *        (thread-safe for multiple readers). The writer cannot publish
+   *        past this version until the visitor returns, keep it short.
+   * @param visitor Callable invoked as visitor(const T&)
+   * @return Whatever the visitor returns
+   */
+  template <typename Visitor> decltype(auto) visit(Visitor &&visitor) const {
+    const Buffer *read_ptr = acquire();
+
+    // Release the pin even if the visitor throws
+    struct Unpin {
+      const Buffer *buffer;
+      ~Unpin() { buffer->ref_count.fetch_sub(1, std::memory_order_release); }
+    } unpin{read_ptr};
+
+    return std::forward<Visitor>(visitor)(value_of(*read_ptr));
+  }
+
+  /**
+   * @brief Pins the current value for as long as the returned handle (or a
+   *        copy of it) lives (thread-safe for multiple readers). Meant for
+   *        long-running readers, read() and visit() stay cheaper.
+   * @return Handle to the current version
+   */
+  Snapshot snapshot() const noexcept {
+    const Buffer *read_ptr = acquire();
+    read_ptr->snapshot_count.fetch_add(1, std::memory_order_relaxed);
+    read_ptr->ref_count.fetch_sub(1, std::memory_order_release);
+    return Snapshot(read_ptr);
+  }
+
+  /**
+   * @brief Updates the stored value (single writer thread only)
+   * @param new_value The new value to store
+   */
+  void write(const T &new_value) noexcept {
+    if (upstream_ != nullptr) {
+      prepare_write_buffer();
+      rebuild(*write_buffer_, new_value);
+      publish();
+      return;
+    }
+    write_with([&new_value](T &data) { assign(data, new_value); });
+  }
+
+  /**
+   * @brief Publishes a freshly built object by pointer, without copying it
+   *        (Indirect storage, single writer thread only)
+   * @param new_value The new object, must not be null
+   * @return The object published two writes ago, no reader refers to it
+   *         any more, so it can be recycled
+   */
+  template <bool Indirect = kIndirect, std::enable_if_t<Indirect, int> = 0>
+  std::unique_ptr<T> write(std::unique_ptr<T> new_value) noexcept {
+    assert(new_value != nullptr && "write() of a null object");
+    prepare_write_buffer();
+    std::swap(write_buffer_->data, new_value);
+    publish();
+    return new_value;
+  }
+
+  /**
+   * @brief Constructs the new value in place on the heap and publishes it
+   *        (Indirect storage, single writer thread only)
+   */
+  template <typename... Args> void emplace(Args &&...args) {
+    write(std::make_unique<T>(std::forward<Args>(args)...));
+  }
+
+  /**
+   * @brief Applies a mutation to a copy of the current value and publishes
+   *        the result (single writer thread only)
+   * @param mutator Callable invoked as mutator(T&)
+   */
+  template <typename Mutator> void update(Mutator &&mutator) {
+    if (upstream_ != nullptr) {
+      prepare_write_buffer();
+      rebuild(*write_buffer_,
+              value_of(*read_buffer_.load(std::memory_order_relaxed)));
+      mutator(value_of(*write_buffer_));
+      publish();
+      return;
+    }
+    write_with([this, &mutator](T &data) {
+      // Only the writer modifies buffers, so the published one is stable
+      data = value_of(*read_buffer_.load(std::memory_order_relaxed));
+      mutator(data);
+    });
+  }
+
+  /**
+   * @brief Fills the back buffer in place and publishes it (single writer
+   *        thread only)
+   * @param fill Callable invoked as fill(T&). The back buffer still holds
+   *        the version before the current one, fill must overwrite it.
+   */
+  template <typename Fill> void write_with(Fill &&fill) {
+    prepare_write_buffer();
+    if constexpr (kIndirect) {
+      static_assert(std::is_copy_constructible_v<T>,
+                    "Move-only T is published with write(unique_ptr)");
+      // The back slot is empty before the second publish
+      if (write_buffer_->data == nullptr) {
+        write_buffer_->data = std::make_unique<T>(
+            value_of(*read_buffer_.load(std::memory_order_relaxed)));
+      }
+    }
+
+    // Update the write buffer (no readers access this yet)
+    fill(value_of(*write_buffer_));
+    publish();
+  }
+
+  /**
+   * @brief Publishes new_value, which differs from the current value only
+   *        within ranges, copying just those bytes plus the ones the
+   *        previous write_ranges() changed (single writer thread only).
+   *        Falls back to a full copy when the back buffer is not exactly
+   *        one version behind, e.g. after write() or a snapshot rotation.
+   * @param ranges Iterable of ByteRange, each within sizeof(T)
+   */
+  template <typename Ranges>
+  void write_ranges(const T &new_value, const Ranges &ranges) noexcept {
+    static_assert(std::is_trivially_copyable_v<T> && !kIndirect,
+                  "write_ranges needs Buffered storage of a trivially "
+                  "copyable T");
+    prepare_write_buffer();
+
+    Buffer &back = *write_buffer_;
+    const Buffer &current = *read_buffer_.load(std::memory_order_relaxed);
+    auto *dst = reinterpret_cast<unsigned char *>(&back.data);
+    const auto *src = reinterpret_cast<const unsigned char *>(&new_value);
+    auto copy = [&](const ByteRange &range) {
+      assert(range.offset <= sizeof(T) &&
+             range.length <= sizeof(T) - range.offset &&
+             "write_ranges() range outside of T");
+      std::memcpy(dst + range.offset, src + range.offset, range.length);
+    };
+
+    if (back.generation == current.generation) {
+      // Same content already, only the new changes are missing
+    } else if (back.generation + 1 == current.generation &&
+               dirty_generation_ == current.generation) {
+      for (const ByteRange &range : last_dirty_) {
+        copy(range);
+      }
+    } else {
+      assign(back.data, new_value);
+    }
+    for (const ByteRange &range : ranges) {
+      copy(range);
+    }
+    last_dirty_.assign(std::begin(ranges), std::end(ranges));
+
+    publish();
+    dirty_generation_ = signal_.generation.load(std::memory_order_relaxed);
+  }
+
+  void write_ranges(const T &new_value,
+                    std::initializer_list<ByteRange> ranges) noexcept {
+    write_ranges<std::initializer_list<ByteRange>>(new_value, ranges);
+  }
+
+  // Number of versions published so far, 0 for the initial value
+  std::uint64_t generation() const noexcept {
+    return signal_.generation.load(std::memory_order_acquire);
+  }
+
+  /**
+   * @brief Blocks until a version newer than seen_generation is published
+   *        or timeout expires. The caller sleeps in the kernel instead of
+   *        polling read(), and write() only issues a wakeup while someone
+   *        waits. (thread-safe for multiple readers)
+   * @return Current generation, greater than seen_generation unless the
+   *         wait timed out
+   */
+  template <typename Rep, typename Period>
+  std::uint64_t
+  wait_for_update(std::uint64_t seen_generation,
+                  std::chrono::duration<Rep, Period> timeout) const noexcept {
+    const auto deadline = detail::deadline_after(timeout);
+    return signal_.wait_until_newer(seen_generation, &deadline);
+  }
+
+  // Same without a time limit
+  std::uint64_t wait_for_update(std::uint64_t seen_generation) const noexcept {
+    return signal_.wait_until_newer(seen_generation, nullptr);
+  }
+
+  // Thread an observer is called on
+  enum class Dispatch {
+    // Inline at the end of every publish, before write() returns
+    writer,
+    // On a notifier thread woken by publishes; versions published while it
+    // is busy are coalesced into one call with the latest
+    notifier,
+  };
+
+  // Observer callback: the generation just published and a view of it,
+  // valid during the call; copy the view to keep the version longer.
+  // Must not throw, nor call write(), subscribe() or unsubscribe().
+  using Observer = void (*)(void *context, std::uint64_t generation,
+                            const Snapshot &view);
+
+  static constexpr std::size_t kMaxObservers = 16;
+
+  /**
+   * @brief Registers observer to be called after every publish (thread-safe).
+   *        Observers live in a fixed array, so dispatching never allocates.
+   * @param context Passed back to observer, must stay valid until
+   *        unsubscribe() returns
+   * @return Id for unsubscribe()
+   * @throws std::length_error when kMaxObservers are already registered
+   */
+  std::size_t subscribe(Observer observer, void *context,
+                        Dispatch dispatch = Dispatch::writer) {
+    Observers &observers = observer_list();
+    const auto group = static_cast<std::size_t>(dispatch);
+    ObserverGroup &entries = observers.groups[group];
+    std::lock_guard<std::mutex> lock(entries.mutex);
+    for (std::size_t i = 0; i < kMaxObservers; ++i) {
+      if (entries.slots[i].callback == nullptr) {
+        entries.slots[i] = {observer, context};
+        entries.count = std::max(entries.count, i + 1);
+        if (dispatch == Dispatch::notifier && !observers.notifier.joinable()) {
+          const std::uint64_t seen = generation();
+          observers.notifier = std::thread(
+              [this, &observers, seen] { notify_loop(observers, seen); });
+        }
+        return group * kMaxObservers + i;
+      }
+    }
+    throw std::length_error("DoubleBuffer: too many observers");
+  }
+
+  /**
+   * @brief Removes an observer; once this returns it is not running and
+   *        will not be called again (thread-safe)
+   */
+  void unsubscribe(std::size_t id) noexcept {
+    Observers *observers = observers_.load(std::memory_order_acquire);
+    if (observers == nullptr) {
+      return;
+    }
+    ObserverGroup &entries = observers->groups[id / kMaxObservers];
+    std::lock_guard<std::mutex> lock(entries.mutex);
+    entries.slots[id % kMaxObservers] = {};
+    while (entries.count > 0 &&
+           entries.slots[entries.count - 1].callback == nullptr) {
+      --entries.count;
+    }
+  }
+
+  /**
+   * @brief Creates, on first call, a non-blocking eventfd that every publish
+   *        adds 1 to, for readers driven by epoll/poll/select. The counter
+   *        accumulates until read, so a burst of publishes makes the fd
+   *        readable once; reading it returns the number of publishes since
+   *        the previous read. (thread-safe, Linux only)
+   * @return The descriptor, owned by the DoubleBuffer
+   * @throws std::system_error when eventfd() fails or is unavailable
+   */
+  int enable_eventfd() {
+    Observers &observers = observer_list();
+    int fd = observers.event_fd.load(std::memory_order_acquire);
+    if (fd >= 0) {
+      return fd;
+    }
+#if defined(__linux__)
+    const int fresh = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fresh < 0) {
+      throw std::system_error(errno, std::generic_category(), "eventfd");
+    }
+    if (observers.event_fd.compare_exchange_strong(
+            fd, fresh, std::memory_order_acq_rel)) {
+      return fresh;
+    }
+    ::close(fresh);
+    return fd;
+#else
+    throw std::system_error(std::make_error_code(std::errc::not_supported),
+                            "eventfd");
+#endif
+  }
+
+  // The descriptor from enable_eventfd(), -1 if it was not enabled
+  int native_handle() const noexcept {
+    const Observers *observers = observers_.load(std::memory_order_acquire);
+    return observers != nullptr
+               ? observers->event_fd.load(std::memory_order_acquire)
+               : -1;
+  }
+
+#if defined(YY_HAS_COROUTINES)
+  /**
+   * Awaitable returned by next_update(). It lives in the awaiting
+   * coroutine's frame and links itself into the buffer's waiter list, so a
+   * parked coroutine costs no thread, timer or allocation.
+   */
+  template <typename Executor>
+  class UpdateAwaiter : private detail::UpdateWaiter {
+  public:
+    bool await_ready() const noexcept {
+      return buffer_.generation() > seen;
+    }
+
+    bool await_suspend(std::coroutine_handle<> handle) {
+      handle_ = handle;
+      wake = &resume_on_executor;
+      return buffer_.park(*this);
+    }
+
+    // Generation that ended the wait
+    std::uint64_t await_resume() const noexcept {
+      return generation > seen ? generation : buffer_.generation();
+    }
+
+  private:
+    friend class DoubleBuffer;
+
+    UpdateAwaiter(DoubleBuffer &buffer, std::uint64_t seen_generation,
+                  Executor executor)
+        : buffer_(buffer), executor_(std::move(executor)) {
+      seen = seen_generation;
+    }
+
+    static void resume_on_executor(detail::UpdateWaiter &waiter) noexcept {
+      auto &self = static_cast<UpdateAwaiter &>(waiter);
+      self.executor_(self.handle_);
+    }
+
+    DoubleBuffer &buffer_;
+    Executor executor_;
+    std::coroutine_handle<> handle_;
+  };
+
+  /**
+   * @brief co_await buffer.next_update(seen) suspends the coroutine until a
+   *        generation newer than seen is published and evaluates to it. The
+   *        coroutine resumes inside the publishing write(), on the writer
+   *        thread. It must not be destroyed while suspended, and is never
+   *        resumed if the DoubleBuffer dies first.
+   */
+  UpdateAwaiter<detail::ResumeInline>
+  next_update(std::uint64_t seen_generation) noexcept {
+    return {*this, seen_generation, {}};
+  }
+
+  // Newer than the version current at the call
+  UpdateAwaiter<detail::ResumeInline> next_update() noexcept {
+    return next_update(generation());
+  }
+
+  /**
+   * @brief Same, but the writer hands the coroutine to
+   *        executor(std::coroutine_handle<>) instead of resuming it inline,
+   *        e.g. to post it to an event loop. executor must not throw.
+   */
+  template <typename Executor>
+  UpdateAwaiter<Executor> next_update(std::uint64_t seen_generation,
+                                      Executor executor) {
+    return {*this, seen_generation, std::move(executor)};
+  }
+#endif
+
+private:
+  struct ObserverSlot {
+    Observer callback{nullptr};
+    void *context{nullptr};
+  };
+
+  struct ObserverGroup {
+    // Held while the group is dispatched
+    std::mutex mutex;
+    std::array<ObserverSlot, kMaxObservers> slots{};
+    // Slots in use are all below count
+    std::size_t count{0};
+  };
+
+  struct Observers {
+    ObserverGroup groups[2];
+    std::thread notifier;
+    std::atomic<bool> stop{false};
+    // Signalled on every publish once enable_eventfd() ran, -1 before
+    std::atomic<int> event_fd{-1};
+    // Coroutines suspended in next_update(); changed under waiter_mutex,
+    // the writer peeks at the head to skip the lock
+    std::mutex waiter_mutex;
+    std::atomic<detail::UpdateWaiter *> waiters{nullptr};
+
+    ~Observers() {
+#if defined(__linux__)
+      // Only enable_eventfd() sets it, and only on Linux
+      if (const int fd = event_fd.load(std::memory_order_relaxed); fd >= 0) {
+        ::close(fd);
+      }
+#endif
+    }
+  };
+
+  Observers &observer_list() {
+    Observers *observers = observers_.load(std::memory_order_acquire);
+    if (observers == nullptr) {
+      auto fresh = std::make_unique<Observers>();
+      if (observers_.compare_exchange_strong(observers, fresh.get(),
+                                             std::memory_order_seq_cst)) {
+        observers = fresh.release();
+      }
+    }
+    return *observers;
+  }
+
+  static void dispatch(ObserverGroup &entries, std::uint64_t generation,
+                       const Snapshot &view) noexcept {
+    std::lock_guard<std::mutex> lock(entries.mutex);
+    for (std::size_t i = 0; i < entries.count; ++i) {
+      const ObserverSlot &slot = entries.slots[i];
+      if (slot.callback != nullptr) {
+        slot.callback(slot.context, generation, view);
+      }
+    }
+  }
+
+  void notify_loop(Observers &observers, std::uint64_t seen) noexcept {
+    while (true) {
+      const std::uint32_t word =
+          signal_.wake_word.load(std::memory_order_seq_cst);
+      if (observers.stop.load(std::memory_order_seq_cst)) {
+        return;
+      }
+      if (signal_.generation.load(std::memory_order_seq_cst) > seen) {
+        // A snapshot never holds up the writer: a publish overlapping the
+        // callbacks rotates in a heap slot, which is reused afterwards
+        const Snapshot view = snapshot();
+        seen = view.generation();
+        constexpr auto group = static_cast<std::size_t>(Dispatch::notifier);
+        dispatch(observers.groups[group], seen, view);
+        continue;
+      }
+      signal_.sleep(word, nullptr);
+    }
+  }
+
+  void stop_notifier(Observers &observers) noexcept {
+    if (!observers.notifier.joinable()) {
+      return;
+    }
+    observers.stop.store(true, std::memory_order_seq_cst);
+    signal_.wake_all();
+    observers.notifier.join();
+  }
+
+  // Signals the eventfd and runs the writer-thread observers for the
+  // version just published
+  void notify_writer_observers() noexcept {
+    // Sequentially consistent for park(), which may create the list
+    Observers *observers = observers_.load(std::memory_order_seq_cst);
+    if (observers == nullptr) {
+      return;
+    }
+#if defined(__linux__)
+    if (const int fd = observers->event_fd.load(std::memory_order_relaxed);
+        fd >= 0) {
+      // Only fails when the counter would overflow, i.e. nobody reads it
+      ::eventfd_write(fd, 1);
+    }
+#endif
+    if (observers->waiters.load(std::memory_order_seq_cst) != nullptr) {
+      resume_waiters(*observers);
+    }
+    ObserverGroup &entries =
+        observers->groups[static_cast<std::size_t>(Dispatch::writer)];
+    // Only the writer retires buffers, so the current one needs no pin
+    // while its observers run
+    const Buffer *current = read_buffer_.load(std::memory_order_relaxed);
+    dispatch(entries, current->generation,
+             Snapshot(current, typename Snapshot::Borrowed{}));
+  }
+
+  // Links waiter into the list unless its update already arrived
+  // @return false if the caller should not suspend
+  bool park(detail::UpdateWaiter &waiter) {
+    Observers &observers = observer_list();
+    std::lock_guard<std::mutex> lock(observers.waiter_mutex);
+    waiter.next = observers.waiters.load(std::memory_order_relaxed);
+    // Sequentially consistent with the generation store in publish(): the
+    // writer either sees this waiter or we see its generation
+    observers.waiters.store(&waiter, std::memory_order_seq_cst);
+    if (signal_.generation.load(std::memory_order_seq_cst) > waiter.seen) {
+      observers.waiters.store(waiter.next, std::memory_order_relaxed);
+      return false;
+    }
+    return true;
+  }
+
+  void resume_waiters(Observers &observers) noexcept {
+    detail::UpdateWaiter *waiter;
+    {
+      std::lock_guard<std::mutex> lock(observers.waiter_mutex);
+      waiter = observers.waiters.exchange(nullptr, std::memory_order_relaxed);
+    }
+    const std::uint64_t generation =
+        signal_.generation.load(std::memory_order_relaxed);
+    while (waiter != nullptr) {
+      // The node lives in the coroutine frame, which may be gone once woken
+      detail::UpdateWaiter *next = waiter->next;
+      waiter->generation = generation;
+      waiter->wake(*waiter);
+      waiter = next;
+    }
+  }
+
+  // Large trivially copyable values are copied with non-temporal stores, the
+  // back buffer is not read again until readers get to it
+  static void assign(T &dst, const T &src) noexcept {
+    if constexpr (std::is_trivially_copyable_v<T> &&
+                  sizeof(T) >= kStreamCopyThreshold) {
+      stream_copy(&dst, &src, sizeof(T));
+    } else {
+      dst = src;
+    }
+  }
+
+  static T &value_of(Buffer &buffer) noexcept {
+    if constexpr (kIndirect) {
+      return *buffer.data;
+    } else {
+      return buffer.data;
+    }
+  }
+
+  static const T &value_of(const Buffer &buffer) noexcept {
+    if constexpr (kIndirect) {
+      return *buffer.data;
+    } else {
+      return buffer.data;
+    }
+  }
+
+  // Recreates buffer.data as a copy of value in a freshly reset arena
+  void rebuild(Buffer &buffer, const T &value) {
+    if constexpr (!kIndirect) {
+      buffer.data.~T();
+      buffer.arena->release();
+      detail::construct_using_allocator(
+          &buffer.data,
+          std::pmr::polymorphic_allocator<std::byte>(buffer.arena.get()),
+          value);
+    }
+  }
+
+  // Spare slot holding the current value, Indirect slots start empty and
+  // are filled by the write
+  Buffer *make_heap_buffer() {
+    Buffer *buffer = slot_resource_ != nullptr
+                         ? ::new (slot_resource_->allocate(sizeof(Buffer),
+                                                           alignof(Buffer)))
+                               Buffer{}
+                         : new Buffer{};
+    if constexpr (!kIndirect) {
+      const T &current = value_of(*read_buffer_.load(std::memory_order_relaxed));
+      if (upstream_ != nullptr) {
+        buffer->arena =
+            std::make_unique<std::pmr::monotonic_buffer_resource>(upstream_);
+        rebuild(*buffer, current);
+      } else {
+        buffer->data = current;
+      }
+      buffer->generation = signal_.generation.load(std::memory_order_relaxed);
+    }
+    return buffer;
+  }
+
+  void prepare_write_buffer() {
+    if (write_buffer_->snapshot_count.load(std::memory_order_acquire) != 0 ||
+        is_heap(write_buffer_)) {
+      rotate_retired();
+    }
+  }
+
+  // Pins the current read buffer, caller must decrement its ref_count
+  const Buffer *acquire() const noexcept {
     // Retry if copied read ptr does not match realtime read ptr
     while (true) {
       // Load the current read buffer
@@ -56,33 +1127,175 @@ public:
         continue; // Retry
       }
 
-      // Copy the data to return
-      T value = read_ptr->data;
+      return read_ptr;
+    }
+  }
 
-      // Decrement reference count when done
-      read_ptr->ref_count.fetch_sub(1, std::memory_order_release);
+  bool is_heap(const Buffer *buffer) const noexcept {
+    return buffer != &buffers_[0] && buffer != &buffers_[1];
+  }
 
-      return value;
+  void release_if_heap(Buffer *buffer) noexcept {
+    if (!is_heap(buffer)) {
+      return;
+    }
+    if (slot_resource_ != nullptr) {
+      buffer->~Buffer();
+      slot_resource_->deallocate(buffer, sizeof(Buffer), alignof(Buffer));
+    } else {
+      delete buffer;
     }
   }
 
-  /**
-   * @brief Updates the stored value (single writer thread only)
-   * @param new_value The new value to store
-   */
-  void write(const T &new_value) noexcept {
-    // Update the write buffer (no readers access this yet)
-    write_buffer_->data = new_value;
+  // Swaps a snapshot-pinned write buffer for a free one, and a heap write
+  // buffer for a free inline one
+  void rotate_retired() {
+    auto is_free = [](const Buffer *buffer) {
+      return buffer->snapshot_count.load(std::memory_order_acquire) == 0;
+    };
+
+    if (!is_free(write_buffer_)) {
+      Buffer *pinned = write_buffer_;
+      // Prefer a free inline buffer, then any free one, then a new slot
+      auto spare = std::find_if(retired_.begin(), retired_.end(),
+                                [&](const Buffer *buffer) {
+                                  return is_free(buffer) && !is_heap(buffer);
+                                });
+      if (spare == retired_.end()) {
+        spare = std::find_if(retired_.begin(), retired_.end(), is_free);
+      }
+      if (spare != retired_.end()) {
+        write_buffer_ = *spare;
+        *spare = pinned;
+      } else {
+        write_buffer_ = make_heap_buffer();
+        retired_.push_back(pinned);
+      }
+    } else if (is_heap(write_buffer_)) {
+      // Move back to an inline buffer once one is free again
+      auto spare = std::find_if(retired_.begin(), retired_.end(),
+                                [&](const Buffer *buffer) {
+                                  return is_free(buffer) && !is_heap(buffer);
+                                });
+      if (spare != retired_.end()) {
+        std::swap(write_buffer_, *spare);
+      }
+    }
+  }
+
+  void publish() noexcept {
+    write_buffer_->generation =
+        signal_.generation.load(std::memory_order_relaxed) + 1;
+    write_buffer_->published = std::chrono::steady_clock::now();
 
     // Atomically swap read and write indices
-    const Buffer *prev_read_ptr =
+    Buffer *prev_read_ptr =
         read_buffer_.exchange(write_buffer_, std::memory_order_acq_rel);
 
+    signal_.publish();
+
     // Wait until all readers are done with the old buffer
     while (prev_read_ptr->ref_count.load(std::memory_order_acquire) != 0) {
       // Avoid busy waiting - yield CPU to other threads
       std::this_thread::yield();
     }
+
+    // The drained buffer becomes the next write target
+    write_buffer_ = prev_read_ptr;
+
+    notify_writer_observers();
+  }
+};
+
+/**
+ * Specialisation for T that fits in one lock-free atomic: reads are a single
+ * load and writes a single store, with no buffers or reference counts.
+ * CountedAtomic adds generation() and wait_for_update(), for a generation
+ * store, a wake word increment and a waiter check on every write.
+ * Observers, eventfds, next_update(), read_stale_ok() and per-version
+ * metadata need Buffered.
+ */
+template <typename T, bool CountWrites>
+class DoubleBuffer<T, SingleAtomicLayout<CountWrites>>
+    : private detail::AtomicWriteCounter<CountWrites> {
+  static_assert(detail::fits_single_atomic<T>::value,
+                "SingleAtomic storage needs a lock-free, trivially copyable T");
+
+private:
+  // The counter, if any, shares the writer's line with value_; readers only
+  // touch it to wait
+  std::atomic<T> value_;
+
+public:
+  // Snapshot of a single word is simply a copy of it
+  class Snapshot {
+  public:
+    Snapshot() = default;
+
+    const T &operator*() const noexcept { return value_; }
+    const T *operator->() const noexcept { return &value_; }
+    explicit operator bool() const noexcept { return valid_; }
+
+  private:
+    friend class DoubleBuffer;
+    explicit Snapshot(const T &value) noexcept : value_(value), valid_(true) {}
+
+    T value_{};
+    bool valid_{false};
+  };
+
+  explicit DoubleBuffer(const T &init_value) : value_(init_value) {}
+
+  // Disallow copy
+  DoubleBuffer(const DoubleBuffer &) = delete;
+  DoubleBuffer &operator=(const DoubleBuffer &) = delete;
+
+  T read() const noexcept { return value_.load(std::memory_order_acquire); }
+
+  template <typename Visitor> decltype(auto) visit(Visitor &&visitor) const {
+    const T value = read();
+    return std::forward<Visitor>(visitor)(value);
+  }
+
+  Snapshot snapshot() const noexcept { return Snapshot(read()); }
+
+  void write(const T &new_value) noexcept {
+    value_.store(new_value, std::memory_order_release);
+    if constexpr (CountWrites) {
+      this->signal.publish();
+    }
+  }
+
+  // Number of writes so far; a read() right after returning n may already
+  // see a later value (CountedAtomic only)
+  std::uint64_t generation() const noexcept {
+    static_assert(CountWrites, "generation() needs yy::CountedAtomic storage");
+    return this->signal.generation.load(std::memory_order_acquire);
+  }
+
+  template <typename Rep, typename Period>
+  std::uint64_t
+  wait_for_update(std::uint64_t seen_generation,
+                  std::chrono::duration<Rep, Period> timeout) const noexcept {
+    static_assert(CountWrites,
+                  "wait_for_update() needs yy::CountedAtomic storage");
+    const auto deadline = detail::deadline_after(timeout);
+    return this->signal.wait_until_newer(seen_generation, &deadline);
   }
+
+  std::uint64_t wait_for_update(std::uint64_t seen_generation) const noexcept {
+    static_assert(CountWrites,
+                  "wait_for_update() needs yy::CountedAtomic storage");
+    return this->signal.wait_until_newer(seen_generation, nullptr);
+  }
+
+  template <typename Mutator> void update(Mutator &&mutator) {
+    // Single writer, nobody else stores in between
+    T value = value_.load(std::memory_order_relaxed);
+    mutator(value);
+    write(value);
+  }
+
+  template <typename Fill> void write_with(Fill &&fill) { update(fill); }
 };
 } // namespace yy
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace yy {
+/**
+ * N independently published values of a trivially copyable T, e.g. one per
+ * instrument, in a compact structure-of-arrays layout: two contiguous
+ * arrays of T and one array of 32-bit per-slot version counters.
+ *
+ * Each slot is double buffered: write(i) fills the copy readers are not
+ * using and then bumps the slot's counter. Readers never block the writer;
+ * they check the counter after copying and retry only when the writer
+ * lapped them (overwrote the copy they were reading).
+ */
+template <typename T, std::size_t N> class DoubleBufferArray {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "DoubleBufferArray copies slots while they may be rewritten, "
+                "T must be trivially copyable");
+  static_assert(N > 0, "DoubleBufferArray needs at least one slot");
+
+private:
+  // Counter of a slot: twice the published version, plus one while the
+  // writer fills the next copy
+  using Counter = std::atomic<std::uint32_t>;
+
+  // Slots processed per fence pair in read_many
+  static constexpr std::size_t kBatch = 64;
+
+  std::unique_ptr<Counter[]> counters_;
+  std::unique_ptr<T[]> copies_[2];
+
+  // Copy holding the version published when the counter read counter
+  static std::size_t published_copy(std::uint32_t counter) noexcept {
+    return (counter >> 1) & 1;
+  }
+
+  // Whether the copy read under before is still intact at after: it is only
+  // rewritten by the write after the next one
+  static bool intact(std::uint32_t before, std::uint32_t after) noexcept {
+    return after - (before & ~std::uint32_t{1}) <= 2;
+  }
+
+  void copy_out(std::size_t i, std::uint32_t counter, T &out) const noexcept {
+    std::memcpy(static_cast<void *>(&out),
+                &copies_[published_copy(counter)][i], sizeof(T));
+  }
+
+public:
+  explicit DoubleBufferArray(const T &init_value = T{})
+      : counters_(new Counter[N]()), copies_{std::unique_ptr<T[]>(new T[N]),
+                                             std::unique_ptr<T[]>(new T[N])} {
+    std::fill_n(copies_[0].get(), N, init_value);
+    std::fill_n(copies_[1].get(), N, init_value);
+  }
+
+  DoubleBufferArray(const DoubleBufferArray &) = delete;
+  DoubleBufferArray &operator=(const DoubleBufferArray &) = delete;
+
+  static constexpr std::size_t size() noexcept { return N; }
+
+  /**
+   * @brief Reads slot i (thread-safe for multiple readers)
+   * @return Copy of the stored data
+   */
+  T read(std::size_t i) const noexcept {
+    T value;
+    while (true) {
+      const std::uint32_t before =
+          counters_[i].load(std::memory_order_acquire);
+      copy_out(i, before, value);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (intact(before, counters_[i].load(std::memory_order_relaxed))) {
+        return value;
+      }
+    }
+  }
+
+  /**
+   * @brief Reads count slots into out, with one pair of fences per batch of
+   *        slots instead of per slot (thread-safe for multiple readers)
+   */
+  void read_many(const std::size_t *indices, std::size_t count,
+                 T *out) const noexcept {
+    std::array<std::uint32_t, kBatch> before;
+    for (std::size_t first = 0; first < count; first += kBatch) {
+      const std::size_t n = std::min(kBatch, count - first);
+      for (std::size_t k = 0; k < n; ++k) {
+        before[k] =
+            counters_[indices[first + k]].load(std::memory_order_relaxed);
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+      for (std::size_t k = 0; k < n; ++k) {
+        copy_out(indices[first + k], before[k], out[first + k]);
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+      for (std::size_t k = 0; k < n; ++k) {
+        const std::size_t i = indices[first + k];
+        const std::uint32_t after =
+            counters_[i].load(std::memory_order_relaxed);
+        if (!intact(before[k], after)) {
+          out[first + k] = read(i);
+        }
+      }
+    }
+  }
+
+  // Same for any range of indices, returning the values in order
+  template <typename Indices>
+  std::vector<T> read_many(const Indices &indices) const {
+    const std::vector<std::size_t> flat(std::begin(indices),
+                                        std::end(indices));
+    std::vector<T> values(flat.size());
+    read_many(flat.data(), flat.size(), values.data());
+    return values;
+  }
+
+  // Number of writes to slot i so far
+  std::uint32_t version(std::size_t i) const noexcept {
+    return counters_[i].load(std::memory_order_acquire) >> 1;
+  }
+
+  /**
+   * @brief Publishes value to slot i (single writer thread only)
+   */
+  void write(std::size_t i, const T &value) noexcept {
+    const std::uint32_t counter =
+        counters_[i].load(std::memory_order_relaxed);
+    counters_[i].store(counter + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    copies_[published_copy(counter + 2)][i] = value;
+    counters_[i].store(counter + 2, std::memory_order_release);
+  }
+
+  /**
+   * @brief Publishes values[k] to slot indices[k] for every k, with one pair
+   *        of fences for the batch (single writer thread only). Indices
+   *        must be distinct. Each slot becomes visible on its own, the
+   *        batch is not atomic as a whole.
+   */
+  void write_many(const std::size_t *indices, const T *values,
+                  std::size_t count) noexcept {
+    for (std::size_t k = 0; k < count; ++k) {
+      Counter &counter = counters_[indices[k]];
+      counter.store(counter.load(std::memory_order_relaxed) + 1,
+                    std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    for (std::size_t k = 0; k < count; ++k) {
+      const std::size_t i = indices[k];
+      const std::uint32_t counter =
+          counters_[i].load(std::memory_order_relaxed);
+      copies_[published_copy(counter + 1)][i] = values[k];
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    for (std::size_t k = 0; k < count; ++k) {
+      Counter &counter = counters_[indices[k]];
+      counter.store(counter.load(std::memory_order_relaxed) + 1,
+                    std::memory_order_relaxed);
+    }
+  }
+};
+} // namespace yy
@@ -0,0 +1,356 @@
+#pragma once
+
+#include "DoubleBuffer.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace yy {
+namespace detail {
+/**
+ * Open-addressing hash table in the style of Swiss tables: slots are split
+ * into groups of 16, each with 16 control bytes holding 7 bits of the hash
+ * of a full slot (or an empty/deleted marker). A lookup compares the tag
+ * against a whole group at once (SSE2), so it touches one line of control
+ * bytes and usually a single slot. K and V must be default constructible.
+ */
+template <typename K, typename V, typename Hash, typename KeyEqual>
+class FlatTable {
+private:
+  static constexpr std::size_t kGroup = 16;
+  static constexpr std::int8_t kEmpty = -128;
+  static constexpr std::int8_t kDeleted = -2;
+
+  // One control byte per slot, full slots hold a tag in [0, 127]
+  std::vector<std::int8_t> ctrl_;
+  std::vector<std::pair<K, V>> slots_;
+  std::size_t size_{0};
+  // Full and deleted slots, bounded by the load factor
+  std::size_t used_{0};
+  Hash hash_;
+  KeyEqual equal_;
+
+public:
+  // Publish this table content corresponds to, kept by DoubleBufferedMap
+  std::uint64_t version{0};
+
+  FlatTable() : ctrl_(kGroup, kEmpty), slots_(kGroup) {}
+
+  std::size_t size() const noexcept { return size_; }
+
+  const V *find(const K &key) const noexcept {
+    const std::size_t slot = locate(key, hash_of(key));
+    return slot == npos ? nullptr : &slots_[slot].second;
+  }
+
+  void insert_or_assign(const K &key, const V &value) {
+    const std::size_t hash = hash_of(key);
+    if (const std::size_t slot = locate(key, hash); slot != npos) {
+      slots_[slot].second = value;
+      return;
+    }
+    // Keep at most 7/8 of the slots full or deleted so probes end quickly
+    if ((used_ + 1) * 8 > ctrl_.size() * 7) {
+      rehash(size_ * 2 >= ctrl_.size() ? ctrl_.size() * 2 : ctrl_.size());
+    }
+    place(key, value, hash);
+  }
+
+  void erase(const K &key) {
+    const std::size_t slot = locate(key, hash_of(key));
+    if (slot != npos) {
+      ctrl_[slot] = kDeleted;
+      slots_[slot] = {};
+      --size_;
+    }
+  }
+
+  template <typename Visitor> void for_each(Visitor &&visitor) const {
+    for (std::size_t i = 0; i < ctrl_.size(); ++i) {
+      if (ctrl_[i] >= 0) {
+        visitor(slots_[i].first, slots_[i].second);
+      }
+    }
+  }
+
+private:
+  static constexpr std::size_t npos = ~std::size_t{0};
+
+  // std::hash is the identity for integers, spread its bits over the whole
+  // word first: the low bits pick the group and the top 7 form the tag
+  std::size_t hash_of(const K &key) const noexcept {
+    std::uint64_t h = static_cast<std::uint64_t>(hash_(key));
+    h *= 0x9e3779b97f4a7c15;
+    h ^= h >> 32;
+    return static_cast<std::size_t>(h);
+  }
+
+  static std::int8_t tag_of(std::size_t hash) noexcept {
+    return static_cast<std::int8_t>(hash >> (sizeof(std::size_t) * 8 - 7));
+  }
+
+  // Bit i set where group[i] == tag
+  static std::uint32_t match(const std::int8_t *group,
+                             std::int8_t tag) noexcept {
+#if defined(__SSE2__)
+    const __m128i ctrl =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(group));
+    return static_cast<std::uint32_t>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(tag))));
+#else
+    std::uint32_t mask = 0;
+    for (std::size_t i = 0; i < kGroup; ++i) {
+      mask |= static_cast<std::uint32_t>(group[i] == tag) << i;
+    }
+    return mask;
+#endif
+  }
+
+  // Bit i set where group[i] is empty or deleted (sign bit set)
+  static std::uint32_t match_free(const std::int8_t *group) noexcept {
+#if defined(__SSE2__)
+    return static_cast<std::uint32_t>(_mm_movemask_epi8(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(group))));
+#else
+    std::uint32_t mask = 0;
+    for (std::size_t i = 0; i < kGroup; ++i) {
+      mask |= static_cast<std::uint32_t>(group[i] < 0) << i;
+    }
+    return mask;
+#endif
+  }
+
+  static unsigned lowest_bit(std::uint32_t mask) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#else
+    unsigned i = 0;
+    while ((mask & 1) == 0) {
+      mask >>= 1;
+      ++i;
+    }
+    return i;
+#endif
+  }
+
+  std::size_t first_group(std::size_t hash) const noexcept {
+    return hash & (ctrl_.size() / kGroup - 1);
+  }
+
+  // Triangular probing visits every group when their number is a power of 2
+  std::size_t next_group(std::size_t group, std::size_t step) const noexcept {
+    return (group + step) & (ctrl_.size() / kGroup - 1);
+  }
+
+  std::size_t locate(const K &key, std::size_t hash) const noexcept {
+    const std::int8_t tag = tag_of(hash);
+    std::size_t group = first_group(hash);
+    for (std::size_t step = 1;; ++step) {
+      const std::int8_t *ctrl = &ctrl_[group * kGroup];
+      for (std::uint32_t mask = match(ctrl, tag); mask != 0;
+           mask &= mask - 1) {
+        const std::size_t slot = group * kGroup + lowest_bit(mask);
+        if (equal_(slots_[slot].first, key)) {
+          return slot;
+        }
+      }
+      if (match(ctrl, kEmpty) != 0 || step > ctrl_.size() / kGroup) {
+        return npos;
+      }
+      group = next_group(group, step);
+    }
+  }
+
+  // Inserts a key known to be absent, capacity permitting
+  void place(const K &key, const V &value, std::size_t hash) {
+    std::size_t group = first_group(hash);
+    for (std::size_t step = 1;; ++step) {
+      if (const std::uint32_t mask = match_free(&ctrl_[group * kGroup])) {
+        const std::size_t slot = group * kGroup + lowest_bit(mask);
+        used_ += ctrl_[slot] == kEmpty;
+        ctrl_[slot] = tag_of(hash);
+        slots_[slot].first = key;
+        slots_[slot].second = value;
+        ++size_;
+        return;
+      }
+      group = next_group(group, step);
+    }
+  }
+
+  // Rebuilds with capacity slots, dropping deleted markers
+  void rehash(std::size_t capacity) {
+    std::vector<std::int8_t> ctrl(capacity, kEmpty);
+    std::vector<std::pair<K, V>> slots(capacity);
+    std::swap(ctrl, ctrl_);
+    std::swap(slots, slots_);
+    size_ = 0;
+    used_ = 0;
+    for (std::size_t i = 0; i < ctrl.size(); ++i) {
+      if (ctrl[i] >= 0) {
+        place(slots[i].first, slots[i].second, hash_of(slots[i].first));
+      }
+    }
+  }
+};
+} // namespace detail
+
+/**
+ * Read-optimised hash map published as a whole: readers pin one version and
+ * look keys up in place, instead of copying a std::unordered_map with
+ * read(). The published table is a flat open-addressing table probed 16
+ * control bytes at a time.
+ *
+ * The writer publishes batches of key updates. The back table is one
+ * version behind, so a publish replays the previous batch on it before
+ * applying the new one, rather than copying the whole map.
+ */
+template <typename K, typename V, typename Hash = std::hash<K>,
+          typename KeyEqual = std::equal_to<K>>
+class DoubleBufferedMap {
+private:
+  using Table = detail::FlatTable<K, V, Hash, KeyEqual>;
+
+public:
+  // Key with its new value, or std::nullopt to erase it
+  using Update = std::pair<K, std::optional<V>>;
+
+  // Updates published together by publish(), applied in order
+  class Batch {
+  public:
+    Batch &set(K key, V value) {
+      updates_.emplace_back(std::move(key), std::move(value));
+      return *this;
+    }
+
+    Batch &erase(K key) {
+      updates_.emplace_back(std::move(key), std::nullopt);
+      return *this;
+    }
+
+    std::size_t size() const noexcept { return updates_.size(); }
+    bool empty() const noexcept { return updates_.empty(); }
+
+  private:
+    friend class DoubleBufferedMap;
+    std::vector<Update> updates_;
+  };
+
+  /**
+   * One published version, pinned until destroyed. Must not outlive the
+   * DoubleBufferedMap.
+   */
+  class View {
+  public:
+    View() = default;
+
+    // Value for key in this version, null if absent
+    const V *find(const K &key) const noexcept {
+      return snapshot_->find(key);
+    }
+
+    bool contains(const K &key) const noexcept {
+      return find(key) != nullptr;
+    }
+
+    std::size_t size() const noexcept { return snapshot_->size(); }
+
+    // Calls visitor(key, value) for every entry, in no particular order
+    template <typename Visitor> void for_each(Visitor &&visitor) const {
+      snapshot_->for_each(std::forward<Visitor>(visitor));
+    }
+
+  private:
+    friend class DoubleBufferedMap;
+    explicit View(typename DoubleBuffer<Table>::Snapshot snapshot) noexcept
+        : snapshot_(std::move(snapshot)) {}
+
+    typename DoubleBuffer<Table>::Snapshot snapshot_;
+  };
+
+  DoubleBufferedMap() : buffer_(Table{}) {}
+
+  // Starts from the (key, value) pairs of init, e.g. a std::unordered_map
+  template <typename Range>
+  explicit DoubleBufferedMap(const Range &init)
+      : buffer_(make_table(init)) {}
+
+  DoubleBufferedMap(const DoubleBufferedMap &) = delete;
+  DoubleBufferedMap &operator=(const DoubleBufferedMap &) = delete;
+
+  /**
+   * @brief Pins the current version for any number of lookups
+   *        (thread-safe for multiple readers)
+   */
+  View pin() const noexcept { return View(buffer_.snapshot()); }
+
+  /**
+   * @brief Single lookup in the current version (thread-safe for multiple
+   *        readers)
+   * @return Copy of the value, std::nullopt if absent
+   */
+  std::optional<V> find(const K &key) const {
+    return buffer_.visit([&key](const Table &table) -> std::optional<V> {
+      if (const V *value = table.find(key)) {
+        return *value;
+      }
+      return std::nullopt;
+    });
+  }
+
+  std::size_t size() const noexcept {
+    return buffer_.visit([](const Table &table) { return table.size(); });
+  }
+
+  /**
+   * @brief Publishes batch as one new version (single writer thread only)
+   */
+  void publish(Batch batch) {
+    buffer_.write_with([&](Table &back) {
+      if (back.version + 1 == version_) {
+        apply(back, last_);
+      } else if (back.version != version_) {
+        // A spare buffer from snapshot rotation, more than one batch behind
+        back = *buffer_.snapshot();
+      }
+      apply(back, batch.updates_);
+      back.version = version_ + 1;
+    });
+    ++version_;
+    last_ = std::move(batch.updates_);
+  }
+
+private:
+  DoubleBuffer<Table> buffer_;
+  // Batch of the latest publish and its table version (single writer)
+  std::vector<Update> last_;
+  std::uint64_t version_{0};
+
+  template <typename Range> static Table make_table(const Range &init) {
+    Table table;
+    for (const auto &[key, value] : init) {
+      table.insert_or_assign(key, value);
+    }
+    return table;
+  }
+
+  static void apply(Table &table, const std::vector<Update> &updates) {
+    for (const auto &[key, value] : updates) {
+      if (value) {
+        table.insert_or_assign(key, *value);
+      } else {
+        table.erase(key);
+      }
+    }
+  }
+};
+} // namespace yy
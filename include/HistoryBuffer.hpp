@@ -0,0 +1,235 @@
+#pragma once
+
+#include "DoubleBuffer.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+namespace yy {
+/**
+ * Keeps the last depth published versions readable, not just the current
+ * one. Versions live in a fixed ring of slots, so memory is bounded and a
+ * publish recycles the slot of the oldest version.
+ *
+ * Readers pin a version by generation, or the latest one published at or
+ * before a point in time, and use it in place. Like DoubleBuffer::read(), a
+ * pin briefly holds up the writer if it sits on the oldest version when
+ * that slot is due for reuse, so pins should be short-lived. T must be
+ * default constructible and copy assignable.
+ */
+template <typename T> class HistoryBuffer {
+public:
+  using Clock = std::chrono::steady_clock;
+
+private:
+  static constexpr std::uint64_t kNoGeneration = ~std::uint64_t{0};
+
+  struct Slot {
+    // Generation held, kNoGeneration while the slot is being recycled
+    alignas(kCacheLineSize) std::atomic<std::uint64_t> generation{
+        kNoGeneration};
+    // Publish time, in Clock ticks
+    std::atomic<Clock::rep> published{0};
+    // Outstanding pins
+    mutable std::atomic<unsigned> pins{0};
+    T value{};
+  };
+
+  std::size_t depth_;
+  std::unique_ptr<Slot[]> slots_;
+  std::atomic<std::uint64_t> latest_{0};
+
+  Slot &slot_of(std::uint64_t generation) const noexcept {
+    return slots_[generation % depth_];
+  }
+
+public:
+  /**
+   * Reference to one version, keeping its slot from being recycled until the
+   * last copy is destroyed. Must not outlive the HistoryBuffer.
+   */
+  class Pin {
+  public:
+    Pin() = default;
+    Pin(const Pin &other) noexcept
+        : slot_(other.slot_), generation_(other.generation_) {
+      if (slot_ != nullptr) {
+        slot_->pins.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+    Pin(Pin &&other) noexcept
+        : slot_(std::exchange(other.slot_, nullptr)),
+          generation_(other.generation_) {}
+    Pin &operator=(Pin other) noexcept {
+      std::swap(slot_, other.slot_);
+      std::swap(generation_, other.generation_);
+      return *this;
+    }
+    ~Pin() {
+      if (slot_ != nullptr) {
+        slot_->pins.fetch_sub(1, std::memory_order_release);
+      }
+    }
+
+    const T &operator*() const noexcept { return slot_->value; }
+    const T *operator->() const noexcept { return &slot_->value; }
+    // False when the requested version is no longer (or not yet) available
+    explicit operator bool() const noexcept { return slot_ != nullptr; }
+
+    std::uint64_t generation() const noexcept { return generation_; }
+
+    Clock::time_point published() const noexcept {
+      return Clock::time_point(Clock::duration(
+          slot_->published.load(std::memory_order_relaxed)));
+    }
+
+  private:
+    friend class HistoryBuffer;
+    // Takes over a pins increment
+    Pin(const Slot *slot, std::uint64_t generation) noexcept
+        : slot_(slot), generation_(generation) {}
+
+    const Slot *slot_{nullptr};
+    // The slot's own generation is cleared as soon as recycling starts
+    std::uint64_t generation_{0};
+  };
+
+  /**
+   * @param depth Number of versions kept readable, at least 2
+   */
+  HistoryBuffer(const T &init_value, std::size_t depth)
+      : depth_(checked_depth(depth)), slots_(new Slot[depth_]) {
+    Slot &first = slots_[0];
+    first.value = init_value;
+    first.published.store(Clock::now().time_since_epoch().count(),
+                          std::memory_order_relaxed);
+    first.generation.store(0, std::memory_order_release);
+  }
+
+  HistoryBuffer(const HistoryBuffer &) = delete;
+  HistoryBuffer &operator=(const HistoryBuffer &) = delete;
+
+  std::size_t depth() const noexcept { return depth_; }
+
+  // Generation of the latest version, 0 for the initial value
+  std::uint64_t generation() const noexcept {
+    return latest_.load(std::memory_order_acquire);
+  }
+
+  /**
+   * @brief Pins the latest version (thread-safe for multiple readers)
+   */
+  Pin latest() const noexcept {
+    while (true) {
+      if (Pin pin = read_at(generation())) {
+        return pin;
+      }
+      // The writer lapped the whole ring meanwhile, try the new latest
+    }
+  }
+
+  /**
+   * @brief Pins the version published as generation (thread-safe for
+   *        multiple readers)
+   * @return Empty Pin if that version was recycled or is not published yet
+   */
+  Pin read_at(std::uint64_t generation) const noexcept {
+    if (generation > this->generation()) {
+      return Pin();
+    }
+    const Slot &slot = slot_of(generation);
+    // Sequentially consistent with recycle(): either the writer sees our pin
+    // or we see the slot being recycled
+    slot.pins.fetch_add(1, std::memory_order_seq_cst);
+    if (slot.generation.load(std::memory_order_seq_cst) != generation) {
+      slot.pins.fetch_sub(1, std::memory_order_release);
+      return Pin();
+    }
+    return Pin(&slot, generation);
+  }
+
+  /**
+   * @brief Pins the latest version published at or before time (thread-safe
+   *        for multiple readers)
+   * @return Empty Pin if every version in the ring is newer than time
+   */
+  Pin at_or_before(Clock::time_point time) const noexcept {
+    const std::uint64_t latest = generation();
+    const Clock::rep limit = time.time_since_epoch().count();
+    for (std::uint64_t back = 0; back < depth_ && back <= latest; ++back) {
+      const std::uint64_t candidate = latest - back;
+      const Slot &slot = slot_of(candidate);
+      if (slot.generation.load(std::memory_order_acquire) != candidate) {
+        break; // Recycled, and so is everything older
+      }
+      if (slot.published.load(std::memory_order_relaxed) <= limit) {
+        // read_at re-checks the generation, so the time read belongs to it
+        return read_at(candidate);
+      }
+    }
+    return Pin();
+  }
+
+  /**
+   * @brief Publishes new_value as the next version, recycling the oldest
+   *        slot (single writer thread only)
+   */
+  void write(const T &new_value) noexcept {
+    write_with([&new_value](T &value) { value = new_value; });
+  }
+
+  /**
+   * @brief Publishes mutator(copy of the latest value) (single writer
+   *        thread only)
+   */
+  template <typename Mutator> void update(Mutator &&mutator) {
+    const T &current =
+        slot_of(latest_.load(std::memory_order_relaxed)).value;
+    write_with([&](T &value) {
+      value = current;
+      mutator(value);
+    });
+  }
+
+  /**
+   * @brief Fills the recycled slot in place and publishes it (single writer
+   *        thread only)
+   * @param fill Invoked as fill(T&) on the value of the oldest version,
+   *        which it must overwrite
+   */
+  template <typename Fill> void write_with(Fill &&fill) {
+    const std::uint64_t next = latest_.load(std::memory_order_relaxed) + 1;
+    Slot &slot = recycle(next);
+    fill(slot.value);
+    slot.published.store(Clock::now().time_since_epoch().count(),
+                         std::memory_order_relaxed);
+    slot.generation.store(next, std::memory_order_release);
+    latest_.store(next, std::memory_order_release);
+  }
+
+private:
+  static std::size_t checked_depth(std::size_t depth) {
+    if (depth < 2) {
+      throw std::invalid_argument("HistoryBuffer needs a depth of at least 2");
+    }
+    return depth;
+  }
+
+  // Takes the slot for generation away from readers and waits for its pins
+  Slot &recycle(std::uint64_t generation) noexcept {
+    Slot &slot = slot_of(generation);
+    slot.generation.store(kNoGeneration, std::memory_order_seq_cst);
+    while (slot.pins.load(std::memory_order_seq_cst) != 0) {
+      std::this_thread::yield();
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot;
+  }
+};
+} // namespace yy
@@ -0,0 +1,307 @@
+#pragma once
+
+#include "DoubleBuffer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+namespace yy {
+constexpr std::size_t kHugePageSize = std::size_t{2} << 20;
+
+struct HugePageOptions {
+  // Touch every page up front so the first publish takes no page faults
+  bool prefault = true;
+  // mlock the pages, best effort (subject to RLIMIT_MEMLOCK)
+  bool lock = false;
+  // Try MAP_HUGETLB (reserved hugetlbfs pages) before transparent huge pages
+  bool hugetlb = false;
+};
+
+namespace detail {
+constexpr std::size_t round_up(std::size_t bytes,
+                               std::size_t alignment) noexcept {
+  return (bytes + alignment - 1) / alignment * alignment;
+}
+
+// Maps bytes (a multiple of kHugePageSize) at a 2 MB aligned address,
+// returns nullptr on failure
+inline void *map_huge_pages(std::size_t bytes,
+                            const HugePageOptions &options) noexcept {
+#if defined(__linux__)
+  void *p = MAP_FAILED;
+#if defined(MAP_HUGETLB)
+  if (options.hugetlb) {
+    p = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  }
+#endif
+  if (p == MAP_FAILED) {
+    // Over-map so the range can be trimmed to a huge page boundary
+    const std::size_t span = bytes + kHugePageSize;
+    void *raw = ::mmap(nullptr, span, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) {
+      return nullptr;
+    }
+    const auto base = reinterpret_cast<std::uintptr_t>(raw);
+    const std::uintptr_t aligned = round_up(base, kHugePageSize);
+    if (aligned > base) {
+      ::munmap(raw, aligned - base);
+    }
+    const std::uintptr_t tail = aligned + bytes;
+    if (base + span > tail) {
+      ::munmap(reinterpret_cast<void *>(tail), base + span - tail);
+    }
+    p = reinterpret_cast<void *>(aligned);
+#if defined(MADV_HUGEPAGE)
+    ::madvise(p, bytes, MADV_HUGEPAGE);
+#endif
+  }
+  if (options.prefault) {
+    // One write per 4 KB page, with THP the first one maps the huge page
+    auto *bytes_ptr = static_cast<volatile unsigned char *>(p);
+    for (std::size_t offset = 0; offset < bytes; offset += 4096) {
+      bytes_ptr[offset] = 0;
+    }
+  }
+  if (options.lock) {
+    ::mlock(p, bytes);
+  }
+  return p;
+#else
+  void *p = ::operator new(bytes, std::align_val_t{kHugePageSize},
+                           std::nothrow);
+  if (p != nullptr && options.prefault) {
+    std::fill_n(static_cast<unsigned char *>(p), bytes, 0);
+  }
+  return p;
+#endif
+}
+
+inline void unmap_huge_pages(void *p, std::size_t bytes) noexcept {
+#if defined(__linux__)
+  ::munmap(p, bytes);
+#else
+  ::operator delete(p, std::align_val_t{kHugePageSize});
+  (void)bytes;
+#endif
+}
+} // namespace detail
+
+/**
+ * memory_resource backed by 2 MB pages. Pass it as the upstream of the
+ * DoubleBuffer pmr constructor so the contents of large containers live in
+ * huge pages. Large requests get their own mapping, which is cached when
+ * freed and handed out again for the same size. Small ones are rounded up
+ * to a power of two and carved from shared regions; freed blocks go to a
+ * free list per size. Either way the chunks an arena releases on every
+ * write() come back already faulted in. Regions and cached mappings are
+ * only returned when the resource dies.
+ */
+class HugePageResource : public std::pmr::memory_resource {
+private:
+  // Requests from this size on get a dedicated mapping
+  static constexpr std::size_t kLargeRequest = kHugePageSize / 2;
+  // Small blocks are kMinBlock << i bytes for a size class i
+  static constexpr std::size_t kMinBlock = 16;
+  static constexpr std::size_t kSizeClasses = 17;
+  static_assert((kMinBlock << (kSizeClasses - 1)) == kLargeRequest,
+                "The largest size class must fit any small request");
+
+  // Freed small block, linked through its first bytes
+  struct FreeBlock {
+    FreeBlock *next;
+  };
+
+  HugePageOptions options_;
+  std::mutex mutex_;
+  // Regions backing small allocations
+  std::vector<std::pair<void *, std::size_t>> regions_;
+  std::size_t region_used_{0};
+  std::array<FreeBlock *, kSizeClasses> free_lists_{};
+  // Freed large mappings kept for reuse, oldest first: arenas release and
+  // re-request the same chunk sizes on every write()
+  std::vector<std::pair<void *, std::size_t>> cached_;
+
+public:
+  explicit HugePageResource(HugePageOptions options = {}) noexcept
+      : options_(options) {}
+
+  HugePageResource(const HugePageResource &) = delete;
+  HugePageResource &operator=(const HugePageResource &) = delete;
+
+  ~HugePageResource() override {
+    for (const auto &[p, bytes] : regions_) {
+      detail::unmap_huge_pages(p, bytes);
+    }
+    for (const auto &[p, bytes] : cached_) {
+      detail::unmap_huge_pages(p, bytes);
+    }
+  }
+
+private:
+  // Freed large mappings kept at most, older ones are unmapped
+  static constexpr std::size_t kMaxCachedMappings = 64;
+
+  static bool is_large(std::size_t bytes, std::size_t alignment) noexcept {
+    return std::max(bytes, alignment) >= kLargeRequest;
+  }
+
+  // Smallest class whose blocks hold bytes; blocks are aligned to their
+  // size, so that covers alignment too
+  static std::size_t size_class(std::size_t bytes,
+                                std::size_t alignment) noexcept {
+    const std::size_t size = std::max(bytes, alignment);
+    std::size_t index = 0;
+    while ((kMinBlock << index) < size) {
+      ++index;
+    }
+    return index;
+  }
+
+  void *do_allocate(std::size_t bytes, std::size_t alignment) override {
+    if (is_large(bytes, alignment)) {
+      const std::size_t mapped = detail::round_up(bytes, kHugePageSize);
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // Newest first, its pages are the most likely to be resident
+        for (auto it = cached_.rbegin(); it != cached_.rend(); ++it) {
+          if (it->second == mapped) {
+            void *p = it->first;
+            cached_.erase(std::next(it).base());
+            return p;
+          }
+        }
+      }
+      void *p = detail::map_huge_pages(mapped, options_);
+      if (p == nullptr) {
+        throw std::bad_alloc();
+      }
+      return p;
+    }
+
+    const std::size_t index = size_class(bytes, alignment);
+    const std::size_t block = kMinBlock << index;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (FreeBlock *reused = free_lists_[index]) {
+      free_lists_[index] = reused->next;
+      return reused;
+    }
+    std::size_t offset = detail::round_up(region_used_, block);
+    if (regions_.empty() || offset + block > regions_.back().second) {
+      void *p = detail::map_huge_pages(kHugePageSize, options_);
+      if (p == nullptr) {
+        throw std::bad_alloc();
+      }
+      regions_.emplace_back(p, kHugePageSize);
+      offset = 0;
+    }
+    region_used_ = offset + block;
+    return static_cast<unsigned char *>(regions_.back().first) + offset;
+  }
+
+  void do_deallocate(void *p, std::size_t bytes,
+                     std::size_t alignment) override {
+    if (is_large(bytes, alignment)) {
+      std::pair<void *, std::size_t> evicted{nullptr, 0};
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (cached_.size() == kMaxCachedMappings) {
+          evicted = cached_.front();
+          cached_.erase(cached_.begin());
+        }
+        cached_.emplace_back(p, detail::round_up(bytes, kHugePageSize));
+      }
+      if (evicted.first != nullptr) {
+        detail::unmap_huge_pages(evicted.first, evicted.second);
+      }
+      return;
+    }
+    const std::size_t index = size_class(bytes, alignment);
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_lists_[index] = ::new (p) FreeBlock{free_lists_[index]};
+  }
+
+  bool do_is_equal(const std::pmr::memory_resource &other) const
+      noexcept override {
+    return this == &other;
+  }
+};
+
+namespace detail {
+// make_huge_page_double_buffer places a HugePageResource for the heap slots
+// right after the DoubleBuffer, in the same mapping
+template <typename T> struct HugePageLayout {
+  static constexpr std::size_t resource_offset =
+      round_up(sizeof(T), alignof(HugePageResource));
+  static constexpr std::size_t bytes =
+      round_up(resource_offset + sizeof(HugePageResource), kHugePageSize);
+
+  static HugePageResource *resource(void *base) noexcept {
+    return reinterpret_cast<HugePageResource *>(
+        static_cast<unsigned char *>(base) + resource_offset);
+  }
+};
+} // namespace detail
+
+// Deleter for objects placed in huge pages by make_huge_page_double_buffer
+template <typename T> struct HugePageDelete {
+  void operator()(T *p) const noexcept {
+    using Layout = detail::HugePageLayout<T>;
+    p->~T();
+    Layout::resource(p)->~HugePageResource();
+    detail::unmap_huge_pages(p, Layout::bytes);
+  }
+};
+
+template <typename T, typename Storage = default_storage_t<T>>
+using HugePageDoubleBuffer =
+    std::unique_ptr<DoubleBuffer<T, Storage>,
+                    HugePageDelete<DoubleBuffer<T, Storage>>>;
+
+/**
+ * @brief Constructs a DoubleBuffer, including both inline buffers, in huge
+ *        pages. Heap slots that pinned buffers are rotated out for come
+ *        from huge pages with the same options too. Meant for large inline
+ *        T (big arrays and structs); for containers pass a HugePageResource
+ *        as constructor argument too.
+ * @param args Forwarded to the DoubleBuffer constructor
+ */
+template <typename T, typename Storage = default_storage_t<T>,
+          typename... Args>
+HugePageDoubleBuffer<T, Storage>
+make_huge_page_double_buffer(const HugePageOptions &options, Args &&...args) {
+  using Buffer = DoubleBuffer<T, Storage>;
+  using Layout = detail::HugePageLayout<Buffer>;
+  void *p = detail::map_huge_pages(Layout::bytes, options);
+  if (p == nullptr) {
+    throw std::bad_alloc();
+  }
+  auto *slots = ::new (Layout::resource(p)) HugePageResource(options);
+  try {
+    auto *buffer = ::new (p) Buffer(std::forward<Args>(args)...);
+    if constexpr (!detail::is_single_atomic<Storage>::value) {
+      buffer->use_slot_resource(slots);
+    }
+    return HugePageDoubleBuffer<T, Storage>(buffer);
+  } catch (...) {
+    slots->~HugePageResource();
+    detail::unmap_huge_pages(p, Layout::bytes);
+    throw;
+  }
+}
+} // namespace yy
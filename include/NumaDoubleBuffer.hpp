@@ -0,0 +1,194 @@
+#pragma once
+
+#include "DoubleBuffer.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(YY_WITH_LIBNUMA)
+#include <numa.h>
+#include <sched.h>
+#endif
+
+namespace yy {
+/**
+ * memory_resource handing out memory bound to one NUMA node. Allocations
+ * are page-granular, so it is meant as the upstream of an arena. Without
+ * libnuma it forwards to the default heap.
+ */
+class NumaNodeResource : public std::pmr::memory_resource {
+private:
+  int node_;
+
+public:
+  explicit NumaNodeResource(int node) noexcept : node_(node) {}
+
+  int node() const noexcept { return node_; }
+
+private:
+  void *do_allocate(std::size_t bytes, std::size_t alignment) override {
+#if defined(YY_WITH_LIBNUMA)
+    // numa_alloc_onnode returns page-aligned memory
+    if (alignment <= 4096) {
+      void *p = ::numa_alloc_onnode(bytes, node_);
+      if (p == nullptr) {
+        throw std::bad_alloc();
+      }
+      return p;
+    }
+#endif
+    return ::operator new(bytes, std::align_val_t{alignment});
+  }
+
+  void do_deallocate(void *p, std::size_t bytes,
+                     std::size_t alignment) override {
+#if defined(YY_WITH_LIBNUMA)
+    if (alignment <= 4096) {
+      ::numa_free(p, bytes);
+      return;
+    }
+#endif
+    ::operator delete(p, bytes, std::align_val_t{alignment});
+  }
+
+  bool do_is_equal(const std::pmr::memory_resource &other) const
+      noexcept override {
+    return this == &other;
+  }
+};
+
+/**
+ * DoubleBuffer replicated once per NUMA node. Each replica is placed in
+ * memory local to its node, as are the contents of allocator-aware T
+ * (pmr containers) through per-node arenas. write() publishes every replica
+ * and readers resolve to the replica of the node they run on.
+ *
+ * Each replica is always consistent, but during a write readers on
+ * different nodes may briefly see different versions.
+ *
+ * Needs YY_WITH_LIBNUMA (set by the CMake target when libnuma is found) and
+ * a NUMA system; otherwise it degrades to a single replica.
+ */
+template <typename T> class NumaDoubleBuffer {
+private:
+  using Buffer = DoubleBuffer<T>;
+
+  static constexpr bool kAllocatorAware =
+      std::uses_allocator_v<T, std::pmr::polymorphic_allocator<std::byte>>;
+
+  struct Replica {
+    std::unique_ptr<NumaNodeResource> resource;
+    Buffer *buffer;
+  };
+
+  std::vector<Replica> replicas_;
+  // Replica index for every CPU, empty with a single replica
+  std::vector<unsigned> cpu_to_replica_;
+
+public:
+  explicit NumaDoubleBuffer(const T &init_value) {
+    int nodes = 1;
+#if defined(YY_WITH_LIBNUMA)
+    if (::numa_available() >= 0) {
+      nodes = ::numa_max_node() + 1;
+    }
+#endif
+    replicas_.reserve(nodes);
+    for (int node = 0; node < nodes; ++node) {
+      replicas_.push_back(make_replica(node, init_value));
+    }
+
+#if defined(YY_WITH_LIBNUMA)
+    if (replicas_.size() > 1) {
+      const int cpus = ::numa_num_configured_cpus();
+      cpu_to_replica_.resize(cpus, 0);
+      for (int cpu = 0; cpu < cpus; ++cpu) {
+        const int node = ::numa_node_of_cpu(cpu);
+        cpu_to_replica_[cpu] = node < 0 ? 0 : static_cast<unsigned>(node);
+      }
+    }
+#endif
+  }
+
+  NumaDoubleBuffer(const NumaDoubleBuffer &) = delete;
+  NumaDoubleBuffer &operator=(const NumaDoubleBuffer &) = delete;
+
+  ~NumaDoubleBuffer() {
+    for (Replica &replica : replicas_) {
+      replica.buffer->~Buffer();
+      replica.resource->deallocate(replica.buffer, sizeof(Buffer),
+                                   alignof(Buffer));
+    }
+  }
+
+  // Number of replicas, one per NUMA node
+  std::size_t replicas() const noexcept { return replicas_.size(); }
+
+  /**
+   * @brief Reads the local replica (thread-safe for multiple readers)
+   * @return Copy of the stored data
+   */
+  T read() const noexcept { return local().read(); }
+
+  template <typename Visitor> decltype(auto) visit(Visitor &&visitor) const {
+    return local().visit(std::forward<Visitor>(visitor));
+  }
+
+  typename Buffer::Snapshot snapshot() const noexcept {
+    return local().snapshot();
+  }
+
+  /**
+   * @brief Publishes new_value to every replica (single writer thread only)
+   */
+  void write(const T &new_value) noexcept {
+    for (Replica &replica : replicas_) {
+      replica.buffer->write(new_value);
+    }
+  }
+
+  /**
+   * @brief Applies mutator once and publishes the result to every replica
+   *        (single writer thread only)
+   */
+  template <typename Mutator> void update(Mutator &&mutator) {
+    T value = replicas_.front().buffer->read();
+    mutator(value);
+    write(value);
+  }
+
+private:
+  static Replica make_replica(int node, const T &init_value) {
+    Replica replica{std::make_unique<NumaNodeResource>(node), nullptr};
+    void *p = replica.resource->allocate(sizeof(Buffer), alignof(Buffer));
+    try {
+      if constexpr (kAllocatorAware) {
+        replica.buffer = ::new (p) Buffer(init_value, replica.resource.get());
+      } else {
+        replica.buffer = ::new (p) Buffer(init_value);
+      }
+    } catch (...) {
+      replica.resource->deallocate(p, sizeof(Buffer), alignof(Buffer));
+      throw;
+    }
+    return replica;
+  }
+
+  const Buffer &local() const noexcept {
+#if defined(YY_WITH_LIBNUMA)
+    if (!cpu_to_replica_.empty()) {
+      const int cpu = ::sched_getcpu();
+      if (cpu >= 0 && static_cast<std::size_t>(cpu) < cpu_to_replica_.size()) {
+        return *replicas_[cpu_to_replica_[cpu]].buffer;
+      }
+    }
+#endif
+    return *replicas_.front().buffer;
+  }
+};
+} // namespace yy
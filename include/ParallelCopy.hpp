@@ -0,0 +1,212 @@
+#pragma once
+
+#include "DoubleBuffer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace yy {
+/**
+ * Small pool of helper threads that split a job into chunks.
+ *
+ * Chunks are claimed one at a time from a shared counter by the helpers
+ * and by the calling thread, so a helper that is descheduled or slowed by
+ * remote memory simply ends up taking fewer chunks.
+ */
+class CopyPool {
+private:
+  std::vector<std::thread> helpers_;
+
+  std::mutex mutex_;
+  std::condition_variable job_ready_;
+  std::condition_variable job_left_;
+  std::uint64_t job_id_{0};
+  bool stop_{false};
+
+  // Current job, body_ is null once the job is closed to late helpers
+  const std::function<void(std::size_t)> *body_{nullptr};
+  std::size_t chunks_{0};
+  std::atomic<std::size_t> next_chunk_{0};
+  // Helpers currently working on the job (guarded by mutex_)
+  std::size_t busy_{0};
+
+public:
+  /**
+   * @param helpers Number of helper threads, the caller of run() works too
+   */
+  explicit CopyPool(std::size_t helpers = default_helpers()) {
+    helpers_.reserve(helpers);
+    for (std::size_t i = 0; i < helpers; ++i) {
+      helpers_.emplace_back([this] { work(); });
+    }
+  }
+
+  CopyPool(const CopyPool &) = delete;
+  CopyPool &operator=(const CopyPool &) = delete;
+
+  ~CopyPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    job_ready_.notify_all();
+    for (auto &helper : helpers_) {
+      helper.join();
+    }
+  }
+
+  // Threads taking part in a job, including the caller
+  std::size_t concurrency() const noexcept { return helpers_.size() + 1; }
+
+  /**
+   * @brief Invokes body(i) once for every i in [0, chunks) across the pool
+   *        and returns when all of them are done (one caller at a time)
+   * @param body Must not throw
+   */
+  void run(std::size_t chunks, const std::function<void(std::size_t)> &body) {
+    if (helpers_.empty() || chunks < 2) {
+      for (std::size_t i = 0; i < chunks; ++i) {
+        body(i);
+      }
+      return;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      body_ = &body;
+      chunks_ = chunks;
+      next_chunk_.store(0, std::memory_order_relaxed);
+      ++job_id_;
+    }
+    job_ready_.notify_all();
+
+    drain(body, chunks);
+
+    // Close the job and wait for helpers still finishing their chunk
+    std::unique_lock<std::mutex> lock(mutex_);
+    body_ = nullptr;
+    job_left_.wait(lock, [&] { return busy_ == 0; });
+  }
+
+private:
+  static std::size_t default_helpers() noexcept {
+    const unsigned hw = std::thread::hardware_concurrency();
+    return std::min<std::size_t>(hw > 1 ? hw - 1 : 0, 7);
+  }
+
+  void drain(const std::function<void(std::size_t)> &body,
+             std::size_t chunks) {
+    for (std::size_t i = next_chunk_.fetch_add(1, std::memory_order_relaxed);
+         i < chunks; i = next_chunk_.fetch_add(1, std::memory_order_relaxed)) {
+      body(i);
+    }
+  }
+
+  void work() {
+    std::uint64_t seen = 0;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      job_ready_.wait(lock, [&] { return stop_ || job_id_ != seen; });
+      if (stop_) {
+        return;
+      }
+      seen = job_id_;
+      if (body_ == nullptr) {
+        continue; // Woke up after the job was already finished
+      }
+      const auto *body = body_;
+      const std::size_t chunks = chunks_;
+      ++busy_;
+      lock.unlock();
+
+      drain(*body, chunks);
+
+      lock.lock();
+      if (--busy_ == 0) {
+        job_left_.notify_all();
+      }
+    }
+  }
+};
+
+namespace detail {
+template <typename T, typename = void>
+struct is_contiguous_range : std::false_type {};
+template <typename T>
+struct is_contiguous_range<T, std::void_t<decltype(std::data(std::declval<T &>())),
+                                          decltype(std::size(std::declval<T &>()))>>
+    : std::true_type {};
+
+template <typename T, typename = void> struct is_resizable : std::false_type {};
+template <typename T>
+struct is_resizable<T, std::void_t<decltype(std::declval<T &>().resize(
+                           std::size(std::declval<T &>())))>>
+    : std::true_type {};
+
+// Copies count elements from src to dst, split into chunks across the pool
+template <typename U>
+void parallel_copy_n(U *dst, const U *src, std::size_t count, CopyPool &pool,
+                     std::size_t chunk_bytes) {
+  const std::size_t per_chunk =
+      std::max<std::size_t>(1, chunk_bytes / sizeof(U));
+  const std::size_t chunks = (count + per_chunk - 1) / per_chunk;
+  pool.run(chunks, [&](std::size_t chunk) {
+    const std::size_t first = chunk * per_chunk;
+    const std::size_t n = std::min(per_chunk, count - first);
+    if constexpr (std::is_trivially_copyable_v<U>) {
+      std::memcpy(dst + first, src + first, n * sizeof(U));
+    } else {
+      std::copy_n(src + first, n, dst + first);
+    }
+  });
+}
+} // namespace detail
+
+/**
+ * @brief Assigns src to dst, splitting the copy across the pool when T is
+ *        array-like (std::vector, std::array, C arrays) or trivially
+ *        copyable. Anything else falls back to plain assignment.
+ * @param chunk_bytes Approximate bytes per chunk
+ */
+template <typename T>
+void parallel_assign(T &dst, const T &src, CopyPool &pool,
+                     std::size_t chunk_bytes = std::size_t{1} << 20) {
+  if constexpr (detail::is_contiguous_range<T>::value) {
+    if constexpr (detail::is_resizable<T>::value) {
+      dst.resize(std::size(src));
+    }
+    detail::parallel_copy_n(std::data(dst), std::data(src), std::size(src),
+                            pool, chunk_bytes);
+  } else if constexpr (std::is_trivially_copyable_v<T>) {
+    detail::parallel_copy_n(reinterpret_cast<unsigned char *>(&dst),
+                            reinterpret_cast<const unsigned char *>(&src),
+                            sizeof(T), pool, chunk_bytes);
+  } else {
+    dst = src;
+  }
+}
+
+/**
+ * @brief Publishes new_value, copying it into the back buffer across the
+ *        pool (single writer thread only)
+ */
+template <typename T, typename Storage>
+void parallel_write(DoubleBuffer<T, Storage> &buffer, const T &new_value,
+                    CopyPool &pool,
+                    std::size_t chunk_bytes = std::size_t{1} << 20) {
+  buffer.write_with([&](T &data) {
+    parallel_assign(data, new_value, pool, chunk_bytes);
+  });
+}
+} // namespace yy
@@ -0,0 +1,295 @@
+#pragma once
+
+#include "DoubleBuffer.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace yy {
+/**
+ * Asynchronous publishing service around DoubleBuffer.
+ *
+ * Producers enqueue replacements or mutations into a lock-free MPSC queue
+ * and return immediately. A dedicated publisher thread drains the queue and
+ * applies everything it finds with a single write(), so producers never
+ * wait for reader drains.
+ */
+template <typename T> class Publisher {
+private:
+  struct Node {
+    std::atomic<Node *> next{nullptr};
+    std::function<void(T &)> apply;
+    // True when the node overwrites the whole value
+    bool replaces{false};
+  };
+
+  DoubleBuffer<T> buffer_;
+
+  // Intrusive MPSC queue (Vyukov), producers push at head_, the publisher
+  // thread pops at tail_. stub_ keeps the queue non-empty.
+  Node stub_;
+  std::atomic<Node *> head_{&stub_};
+  Node *tail_{&stub_};
+
+  // Number of updates enqueued / published so far
+  std::atomic<std::uint64_t> enqueued_{0};
+  std::uint64_t published_{0};
+
+  // Set while the publisher thread is parked on wakeup_
+  std::atomic<bool> sleeping_{false};
+  bool stop_{false};
+  std::mutex mutex_;
+  std::condition_variable wakeup_;
+  std::condition_variable flushed_;
+
+  std::thread thread_;
+
+  // Coalesced background rebuild, at most one pending and one running
+  std::function<T(const T &)> pending_rebuild_;
+  bool rebuild_running_{false};
+  bool rebuild_stop_{false};
+  std::mutex rebuild_mutex_;
+  std::condition_variable rebuild_cv_;
+  std::thread rebuild_thread_;
+
+public:
+  explicit Publisher(const T &init_value)
+      : buffer_(init_value), thread_([this] { run(); }) {}
+
+  Publisher(const Publisher &) = delete;
+  Publisher &operator=(const Publisher &) = delete;
+
+  // Publishes everything still queued, then stops the publisher thread.
+  // A rebuild that has not started yet is discarded.
+  ~Publisher() {
+    if (rebuild_thread_.joinable()) {
+      {
+        std::lock_guard<std::mutex> lock(rebuild_mutex_);
+        rebuild_stop_ = true;
+      }
+      rebuild_cv_.notify_all();
+      rebuild_thread_.join();
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+      sleeping_.store(false);
+    }
+    wakeup_.notify_one();
+    thread_.join();
+  }
+
+  /**
+   * @brief Reads the current value (thread-safe for multiple readers)
+   * @return Copy of the stored data
+   */
+  T read() const noexcept { return buffer_.read(); }
+
+  // Underlying buffer, for readers only; never write to it directly
+  const DoubleBuffer<T> &buffer() const noexcept { return buffer_; }
+
+  /**
+   * @brief Enqueues a replacement value (thread-safe, never blocks on readers)
+   * @param new_value The new value to publish
+   */
+  void publish(T new_value) {
+    Node *node = new Node;
+    node->apply = [value = std::move(new_value)](T &data) mutable {
+      data = std::move(value);
+    };
+    node->replaces = true;
+    push(node);
+  }
+
+  /**
+   * @brief Enqueues a mutation of the current value (thread-safe, never
+   *        blocks on readers). Mutations are applied in enqueue order.
+   * @param mutator Callable invoked as mutator(T&) on the publisher thread
+   */
+  template <typename Mutator> void update(Mutator &&mutator) {
+    Node *node = new Node;
+    node->apply = std::forward<Mutator>(mutator);
+    push(node);
+  }
+
+  /**
+   * @brief Rebuilds the value on a background thread and publishes the
+   *        result. A request that has not started yet is superseded by the
+   *        next one, so only the latest pending builder runs.
+   * @param builder Invoked as builder(current) against a pinned view of the
+   *        current value, returns the replacement
+   */
+  void rebuild_async(std::function<T(const T &)> builder) {
+    {
+      std::lock_guard<std::mutex> lock(rebuild_mutex_);
+      pending_rebuild_ = std::move(builder);
+      if (!rebuild_thread_.joinable()) {
+        rebuild_thread_ = std::thread([this] { run_rebuilds(); });
+      }
+    }
+    rebuild_cv_.notify_all();
+  }
+
+  /**
+   * @brief Blocks until every update enqueued and every rebuild requested
+   *        before the call is published
+   */
+  void flush() {
+    {
+      std::unique_lock<std::mutex> lock(rebuild_mutex_);
+      rebuild_cv_.wait(lock,
+                       [&] { return !pending_rebuild_ && !rebuild_running_; });
+    }
+    const std::uint64_t target = enqueued_.load();
+    std::unique_lock<std::mutex> lock(mutex_);
+    flushed_.wait(lock, [&] { return published_ >= target; });
+  }
+
+private:
+  void push(Node *node) {
+    enqueued_.fetch_add(1);
+    Node *prev = head_.exchange(node);
+    prev->next.store(node);
+
+    // Wake the publisher if it is parked
+    if (sleeping_.load()) {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        sleeping_.store(false);
+      }
+      wakeup_.notify_one();
+    }
+  }
+
+  // Single consumer only. May return nullptr while a push is in flight.
+  Node *pop() {
+    Node *tail = tail_;
+    Node *next = tail->next.load();
+    if (tail == &stub_) {
+      if (next == nullptr) {
+        return nullptr;
+      }
+      tail_ = next;
+      tail = next;
+      next = next->next.load();
+    }
+    if (next != nullptr) {
+      tail_ = next;
+      return tail;
+    }
+    if (tail != head_.load()) {
+      return nullptr;
+    }
+    // tail is the last node, re-insert the stub to detach it
+    stub_.next.store(nullptr);
+    Node *prev = head_.exchange(&stub_);
+    prev->next.store(&stub_);
+    next = tail->next.load();
+    if (next != nullptr) {
+      tail_ = next;
+      return tail;
+    }
+    return nullptr;
+  }
+
+  void run() {
+    while (true) {
+      // Collect everything currently queued, in enqueue order
+      Node *first = nullptr;
+      Node *last = nullptr;
+      Node *last_replace = nullptr;
+      std::uint64_t count = 0;
+      for (Node *node = pop(); node != nullptr; node = pop()) {
+        // The queue no longer reads a popped node's link, reuse it
+        node->next.store(nullptr, std::memory_order_relaxed);
+        if (last != nullptr) {
+          last->next.store(node, std::memory_order_relaxed);
+        } else {
+          first = node;
+        }
+        last = node;
+        if (node->replaces) {
+          last_replace = node;
+        }
+        ++count;
+      }
+
+      if (count == 0) {
+        if (!park()) {
+          return;
+        }
+        continue;
+      }
+
+      auto apply_from = [](T &data, Node *node) {
+        for (; node != nullptr;
+             node = node->next.load(std::memory_order_relaxed)) {
+          node->apply(data);
+        }
+      };
+      if (last_replace != nullptr) {
+        // Everything before the last replacement is overwritten anyway
+        buffer_.write_with([&](T &data) { apply_from(data, last_replace); });
+      } else {
+        buffer_.update([&](T &data) { apply_from(data, first); });
+      }
+
+      while (first != nullptr) {
+        Node *next = first->next.load(std::memory_order_relaxed);
+        delete first;
+        first = next;
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        published_ += count;
+      }
+      flushed_.notify_all();
+    }
+  }
+
+  void run_rebuilds() {
+    std::unique_lock<std::mutex> lock(rebuild_mutex_);
+    while (true) {
+      rebuild_cv_.wait(lock, [&] { return pending_rebuild_ || rebuild_stop_; });
+      if (rebuild_stop_) {
+        return;
+      }
+      std::function<T(const T &)> builder = std::move(pending_rebuild_);
+      pending_rebuild_ = nullptr;
+      rebuild_running_ = true;
+      lock.unlock();
+
+      // A snapshot keeps the publisher thread from waiting on the build
+      const auto current = buffer_.snapshot();
+      publish(builder(*current));
+
+      lock.lock();
+      rebuild_running_ = false;
+      rebuild_cv_.notify_all();
+    }
+  }
+
+  // Sleeps until new work arrives, returns false once stopped and drained
+  bool park() {
+    sleeping_.store(true);
+    // Re-check after announcing, a producer may have pushed meanwhile
+    if (tail_->next.load() != nullptr || head_.load() != tail_) {
+      sleeping_.store(false);
+      return true;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    wakeup_.wait(lock, [&] { return !sleeping_.load() || stop_; });
+    if (stop_ && head_.load() == tail_ && tail_->next.load() == nullptr) {
+      return false;
+    }
+    sleeping_.store(false);
+    return true;
+  }
+};
+} // namespace yy
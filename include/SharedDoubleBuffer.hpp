@@ -0,0 +1,241 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace yy {
+/**
+ * Double buffer living in a shared memory mapping, for one publisher process
+ * and any number of reader processes.
+ *
+ * Every buffer is guarded by a sequence counter (seqlock). Readers never
+ * store to the mapping, they map it read-only, so a reader that crashes at
+ * any point cannot pin a buffer or wedge the writer. A writer that dies
+ * mid-write leaves only the unpublished buffer torn.
+ *
+ * T must be trivially copyable; pointers inside it must be offsets, as the
+ * mapping lands at a different address in every process.
+ */
+template <typename T> class SharedDoubleBuffer {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "T must be trivially copyable to be shared across processes");
+  static_assert(std::atomic<std::uint64_t>::is_always_lock_free &&
+                    std::atomic<std::uint32_t>::is_always_lock_free,
+                "Cross-process atomics must be lock-free");
+
+private:
+  static constexpr std::uint64_t kMagic = 0x797944424c425546; // "yyDBLBUF"
+  static constexpr std::size_t kAlignment = std::max<std::size_t>(64, alignof(T));
+
+  struct alignas(kAlignment) Slot {
+    // Odd while the writer is copying into data
+    std::atomic<std::uint64_t> seq{0};
+    alignas(kAlignment) T data;
+  };
+
+  struct Layout {
+    // Written last, openers check it to detect an unfinished create
+    std::atomic<std::uint64_t> magic{0};
+    std::uint64_t value_size{sizeof(T)};
+    alignas(64) std::atomic<std::uint32_t> current{0};
+    std::atomic<std::uint64_t> generation{0};
+    Slot slots[2];
+  };
+
+  int fd_{-1};
+  Layout *layout_{nullptr};
+  bool writable_{false};
+
+  SharedDoubleBuffer(int fd, Layout *layout, bool writable) noexcept
+      : fd_(fd), layout_(layout), writable_(writable) {}
+
+public:
+  /**
+   * @brief Creates (or re-initialises) a named POSIX shared memory object
+   *        and becomes its writer
+   * @param name shm_open name, e.g. "/config"
+   */
+  static SharedDoubleBuffer create(const std::string &name,
+                                   const T &init_value) {
+    const int fd = ::shm_open(name.c_str(), O_CREAT | O_RDWR, 0600);
+    if (fd < 0) {
+      throw std::system_error(errno, std::generic_category(), "shm_open");
+    }
+    return initialise(fd, init_value);
+  }
+
+  /**
+   * @brief Creates an anonymous memfd mapping and becomes its writer; hand
+   *        fd() to readers through fork or SCM_RIGHTS
+   */
+  static SharedDoubleBuffer create_anonymous(const T &init_value) {
+    const int fd = ::memfd_create("yy::SharedDoubleBuffer", MFD_CLOEXEC);
+    if (fd < 0) {
+      throw std::system_error(errno, std::generic_category(), "memfd_create");
+    }
+    return initialise(fd, init_value);
+  }
+
+  /**
+   * @brief Opens a named buffer read-only as a reader
+   */
+  static SharedDoubleBuffer open(const std::string &name) {
+    const int fd = ::shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+      throw std::system_error(errno, std::generic_category(), "shm_open");
+    }
+    return map_reader(fd);
+  }
+
+  /**
+   * @brief Maps a buffer read-only from a file descriptor as a reader, the
+   *        descriptor is duplicated and stays owned by the caller
+   */
+  static SharedDoubleBuffer attach(int fd) {
+    const int own = ::fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    if (own < 0) {
+      throw std::system_error(errno, std::generic_category(), "fcntl");
+    }
+    return map_reader(own);
+  }
+
+  // Removes the name, existing mappings stay valid
+  static void unlink(const std::string &name) noexcept {
+    ::shm_unlink(name.c_str());
+  }
+
+  SharedDoubleBuffer(SharedDoubleBuffer &&other) noexcept
+      : fd_(std::exchange(other.fd_, -1)),
+        layout_(std::exchange(other.layout_, nullptr)),
+        writable_(other.writable_) {}
+
+  SharedDoubleBuffer &operator=(SharedDoubleBuffer &&other) noexcept {
+    std::swap(fd_, other.fd_);
+    std::swap(layout_, other.layout_);
+    std::swap(writable_, other.writable_);
+    return *this;
+  }
+
+  ~SharedDoubleBuffer() {
+    if (layout_ != nullptr) {
+      ::munmap(layout_, sizeof(Layout));
+    }
+    if (fd_ >= 0) {
+      ::close(fd_);
+    }
+  }
+
+  /**
+   * @brief Reads the current value (thread- and process-safe, wait-free
+   *        unless the writer laps the reader)
+   * @return Copy of the stored data
+   */
+  T read() const noexcept {
+    T value;
+    while (true) {
+      const Slot &slot =
+          layout_->slots[layout_->current.load(std::memory_order_acquire)];
+      const std::uint64_t before = slot.seq.load(std::memory_order_acquire);
+      if (before & 1) {
+        continue; // Writer lapped us and is rewriting this slot
+      }
+      std::memcpy(static_cast<void *>(&value), &slot.data, sizeof(T));
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot.seq.load(std::memory_order_relaxed) == before) {
+        return value;
+      }
+    }
+  }
+
+  /**
+   * @brief Publishes new_value (writer process, single writer thread only)
+   */
+  void write(const T &new_value) noexcept {
+    assert(writable_ && "write() on a reader mapping");
+    const std::uint32_t back =
+        1 - layout_->current.load(std::memory_order_relaxed);
+    Slot &slot = layout_->slots[back];
+
+    const std::uint64_t seq = slot.seq.load(std::memory_order_relaxed);
+    slot.seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(static_cast<void *>(&slot.data), &new_value, sizeof(T));
+    slot.seq.store(seq + 2, std::memory_order_release);
+
+    layout_->current.store(back, std::memory_order_release);
+    layout_->generation.fetch_add(1, std::memory_order_release);
+  }
+
+  // Number of writes published since creation
+  std::uint64_t generation() const noexcept {
+    return layout_->generation.load(std::memory_order_acquire);
+  }
+
+  int fd() const noexcept { return fd_; }
+
+  bool writable() const noexcept { return writable_; }
+
+private:
+  static SharedDoubleBuffer initialise(int fd, const T &init_value) {
+    if (::ftruncate(fd, sizeof(Layout)) != 0) {
+      const int error = errno;
+      ::close(fd);
+      throw std::system_error(error, std::generic_category(), "ftruncate");
+    }
+    void *p = ::mmap(nullptr, sizeof(Layout), PROT_READ | PROT_WRITE,
+                     MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+      const int error = errno;
+      ::close(fd);
+      throw std::system_error(error, std::generic_category(), "mmap");
+    }
+
+    auto *layout = ::new (p) Layout;
+    for (Slot &slot : layout->slots) {
+      std::memcpy(static_cast<void *>(&slot.data), &init_value, sizeof(T));
+    }
+    layout->magic.store(kMagic, std::memory_order_release);
+    return SharedDoubleBuffer(fd, layout, true);
+  }
+
+  static SharedDoubleBuffer map_reader(int fd) {
+    struct stat st {};
+    if (::fstat(fd, &st) != 0 ||
+        static_cast<std::size_t>(st.st_size) < sizeof(Layout)) {
+      ::close(fd);
+      throw std::runtime_error("SharedDoubleBuffer: mapping too small");
+    }
+    void *p = ::mmap(nullptr, sizeof(Layout), PROT_READ, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+      const int error = errno;
+      ::close(fd);
+      throw std::system_error(error, std::generic_category(), "mmap");
+    }
+
+    auto *layout = static_cast<Layout *>(p);
+    if (layout->magic.load(std::memory_order_acquire) != kMagic ||
+        layout->value_size != sizeof(T)) {
+      ::munmap(p, sizeof(Layout));
+      ::close(fd);
+      throw std::runtime_error("SharedDoubleBuffer: not initialised or "
+                               "created for a different T");
+    }
+    return SharedDoubleBuffer(fd, layout, false);
+  }
+};
+} // namespace yy
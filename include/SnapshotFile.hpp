@@ -0,0 +1,209 @@
+#pragma once
+
+#include "DoubleBuffer.hpp"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace yy {
+namespace detail {
+struct SnapshotFileHeader {
+  std::uint64_t magic;
+  std::uint64_t value_size;
+  std::uint64_t value_align;
+  std::uint64_t checksum;
+};
+
+constexpr std::uint64_t kSnapshotMagic = 0x31305041'4e537979; // "yySNAP01"
+// Value starts on a page boundary so the mapping is suitably aligned
+constexpr std::size_t kSnapshotDataOffset = 4096;
+
+// FNV-1a over 8-byte words, cheap enough to run in the background
+inline std::uint64_t snapshot_checksum(const void *data,
+                                       std::size_t bytes) noexcept {
+  const auto *p = static_cast<const unsigned char *>(data);
+  std::uint64_t hash = 0xcbf29ce484222325;
+  std::size_t i = 0;
+  for (; i + 8 <= bytes; i += 8) {
+    std::uint64_t word;
+    std::memcpy(&word, p + i, 8);
+    hash = (hash ^ word) * 0x100000001b3;
+  }
+  for (; i < bytes; ++i) {
+    hash = (hash ^ p[i]) * 0x100000001b3;
+  }
+  return hash;
+}
+
+inline void write_all(int fd, const void *data, std::size_t bytes,
+                      off_t offset) {
+  const auto *p = static_cast<const char *>(data);
+  while (bytes > 0) {
+    const ssize_t n = ::pwrite(fd, p, bytes, offset);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::system_error(errno, std::generic_category(), "pwrite");
+    }
+    p += n;
+    bytes -= static_cast<std::size_t>(n);
+    offset += n;
+  }
+}
+} // namespace detail
+
+/**
+ * @brief Persists value to path for a later warm restart. The file is
+ *        written under a temporary name, synced and renamed into place, so
+ *        a crash never leaves a half-written snapshot behind.
+ */
+template <typename T> void save_snapshot(const T &value, const std::string &path) {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "Only trivially copyable T can be persisted as an image");
+  static_assert(alignof(T) <= detail::kSnapshotDataOffset,
+                "T is over-aligned for the snapshot format");
+
+  const std::string tmp = path + ".tmp";
+  const int fd = ::open(tmp.c_str(), O_CREAT | O_TRUNC | O_WRONLY | O_CLOEXEC,
+                        0644);
+  if (fd < 0) {
+    throw std::system_error(errno, std::generic_category(), "open");
+  }
+  try {
+    const detail::SnapshotFileHeader header{
+        detail::kSnapshotMagic, sizeof(T), alignof(T),
+        detail::snapshot_checksum(&value, sizeof(T))};
+    detail::write_all(fd, &header, sizeof(header), 0);
+    detail::write_all(fd, &value, sizeof(T), detail::kSnapshotDataOffset);
+    if (::fsync(fd) != 0) {
+      throw std::system_error(errno, std::generic_category(), "fsync");
+    }
+  } catch (...) {
+    ::close(fd);
+    ::unlink(tmp.c_str());
+    throw;
+  }
+  ::close(fd);
+  if (::rename(tmp.c_str(), path.c_str()) != 0) {
+    const int error = errno;
+    ::unlink(tmp.c_str());
+    throw std::system_error(error, std::generic_category(), "rename");
+  }
+}
+
+/**
+ * @brief Persists the currently published value of buffer. Pins it with a
+ *        snapshot, so the writer is not held up while the file is written.
+ */
+template <typename T, typename Storage>
+void save_snapshot(const DoubleBuffer<T, Storage> &buffer,
+                   const std::string &path) {
+  const auto pinned = buffer.snapshot();
+  save_snapshot(*pinned, path);
+}
+
+/**
+ * Read-only mapping of a file written by save_snapshot. Construct the
+ * DoubleBuffer straight from *snapshot on startup; pages are faulted in from
+ * the page cache as the copy touches them. validate() recomputes the
+ * checksum and can run in the background once the service is up.
+ *
+ * DoubleBuffer keeps both copies of T inline, so it cannot adopt the
+ * mapping: construction still reads the whole image and copies it into
+ * both buffers. The mapping skips parsing and rebuilding, not that copy.
+ */
+template <typename T> class MappedSnapshot {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "Only trivially copyable T can be persisted as an image");
+
+private:
+  void *mapping_{nullptr};
+  std::size_t length_{0};
+
+  MappedSnapshot(void *mapping, std::size_t length) noexcept
+      : mapping_(mapping), length_(length) {}
+
+  const detail::SnapshotFileHeader &header() const noexcept {
+    return *static_cast<const detail::SnapshotFileHeader *>(mapping_);
+  }
+
+public:
+  /**
+   * @brief Maps path, checking the header matches T (not the checksum)
+   */
+  static MappedSnapshot open(const std::string &path) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      throw std::system_error(errno, std::generic_category(), "open");
+    }
+    const std::size_t length = detail::kSnapshotDataOffset + sizeof(T);
+    struct stat st {};
+    if (::fstat(fd, &st) != 0 ||
+        static_cast<std::size_t>(st.st_size) < length) {
+      ::close(fd);
+      throw std::runtime_error("MappedSnapshot: truncated file " + path);
+    }
+    void *p = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    const int error = errno;
+    ::close(fd);
+    if (p == MAP_FAILED) {
+      throw std::system_error(error, std::generic_category(), "mmap");
+    }
+    // The image is about to be copied front to back, start reading it ahead
+    ::madvise(p, length, MADV_SEQUENTIAL);
+    ::madvise(p, length, MADV_WILLNEED);
+
+    MappedSnapshot snapshot(p, length);
+    const auto &h = snapshot.header();
+    if (h.magic != detail::kSnapshotMagic || h.value_size != sizeof(T) ||
+        h.value_align != alignof(T)) {
+      throw std::runtime_error("MappedSnapshot: " + path +
+                               " was not written for this T");
+    }
+    return snapshot;
+  }
+
+  MappedSnapshot(MappedSnapshot &&other) noexcept
+      : mapping_(std::exchange(other.mapping_, nullptr)),
+        length_(std::exchange(other.length_, 0)) {}
+
+  MappedSnapshot &operator=(MappedSnapshot &&other) noexcept {
+    std::swap(mapping_, other.mapping_);
+    std::swap(length_, other.length_);
+    return *this;
+  }
+
+  ~MappedSnapshot() {
+    if (mapping_ != nullptr) {
+      ::munmap(mapping_, length_);
+    }
+  }
+
+  const T &operator*() const noexcept {
+    return *reinterpret_cast<const T *>(
+        static_cast<const char *>(mapping_) + detail::kSnapshotDataOffset);
+  }
+  const T *operator->() const noexcept { return &**this; }
+
+  /**
+   * @brief Recomputes the checksum over the whole image
+   * @return true if the image is intact
+   */
+  bool validate() const noexcept {
+    return detail::snapshot_checksum(&**this, sizeof(T)) == header().checksum;
+  }
+};
+} // namespace yy
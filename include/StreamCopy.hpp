@@ -0,0 +1,131 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define YY_HAS_STREAM_COPY 1
+#endif
+
+namespace yy {
+// Trivially copyable values from this size on are published with
+// non-temporal stores, see DoubleBuffer::write
+#if defined(YY_STREAM_COPY_THRESHOLD)
+constexpr std::size_t kStreamCopyThreshold = YY_STREAM_COPY_THRESHOLD;
+#else
+constexpr std::size_t kStreamCopyThreshold = std::size_t{512} << 10;
+#endif
+
+namespace detail {
+#if defined(YY_HAS_STREAM_COPY)
+// Each kernel copies whole vectors to a dst aligned to the vector width and
+// returns the bytes it copied. Stores bypass the cache; the caller fences.
+__attribute__((target("avx512f"))) inline std::size_t
+stream_copy_avx512(unsigned char *dst, const unsigned char *src,
+                   std::size_t bytes) noexcept {
+  std::size_t i = 0;
+  for (; i + 256 <= bytes; i += 256) {
+    const __m512i a = _mm512_loadu_si512(src + i);
+    const __m512i b = _mm512_loadu_si512(src + i + 64);
+    const __m512i c = _mm512_loadu_si512(src + i + 128);
+    const __m512i d = _mm512_loadu_si512(src + i + 192);
+    _mm512_stream_si512(reinterpret_cast<__m512i *>(dst + i), a);
+    _mm512_stream_si512(reinterpret_cast<__m512i *>(dst + i + 64), b);
+    _mm512_stream_si512(reinterpret_cast<__m512i *>(dst + i + 128), c);
+    _mm512_stream_si512(reinterpret_cast<__m512i *>(dst + i + 192), d);
+  }
+  for (; i + 64 <= bytes; i += 64) {
+    _mm512_stream_si512(reinterpret_cast<__m512i *>(dst + i),
+                        _mm512_loadu_si512(src + i));
+  }
+  return i;
+}
+
+__attribute__((target("avx2"))) inline std::size_t
+stream_copy_avx2(unsigned char *dst, const unsigned char *src,
+                 std::size_t bytes) noexcept {
+  std::size_t i = 0;
+  for (; i + 128 <= bytes; i += 128) {
+    const __m256i a =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+    const __m256i b =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i + 32));
+    const __m256i c =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i + 64));
+    const __m256i d =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i + 96));
+    _mm256_stream_si256(reinterpret_cast<__m256i *>(dst + i), a);
+    _mm256_stream_si256(reinterpret_cast<__m256i *>(dst + i + 32), b);
+    _mm256_stream_si256(reinterpret_cast<__m256i *>(dst + i + 64), c);
+    _mm256_stream_si256(reinterpret_cast<__m256i *>(dst + i + 96), d);
+  }
+  for (; i + 32 <= bytes; i += 32) {
+    _mm256_stream_si256(
+        reinterpret_cast<__m256i *>(dst + i),
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i)));
+  }
+  return i;
+}
+
+// SSE2 is part of x86-64, so this one needs no check
+inline std::size_t stream_copy_sse2(unsigned char *dst,
+                                    const unsigned char *src,
+                                    std::size_t bytes) noexcept {
+  std::size_t i = 0;
+  for (; i + 16 <= bytes; i += 16) {
+    _mm_stream_si128(
+        reinterpret_cast<__m128i *>(dst + i),
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i)));
+  }
+  return i;
+}
+
+using StreamKernel = std::size_t (*)(unsigned char *, const unsigned char *,
+                                     std::size_t) noexcept;
+
+// Widest kernel the CPU supports, picked once
+inline StreamKernel stream_kernel() noexcept {
+  static const StreamKernel kernel = [] {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+      return StreamKernel{&stream_copy_avx512};
+    }
+    if (__builtin_cpu_supports("avx2")) {
+      return StreamKernel{&stream_copy_avx2};
+    }
+    return StreamKernel{&stream_copy_sse2};
+  }();
+  return kernel;
+}
+#endif
+} // namespace detail
+
+/**
+ * @brief memcpy with non-temporal stores: the destination is not pulled into
+ *        the cache, so copying a large value does not evict the working set
+ *        of other cores sharing the L3. Falls back to memcpy off x86-64.
+ *        Ends with a store fence, so a following release store (a publish)
+ *        orders after the copied bytes.
+ */
+inline void stream_copy(void *dst, const void *src,
+                        std::size_t bytes) noexcept {
+#if defined(YY_HAS_STREAM_COPY)
+  auto *d = static_cast<unsigned char *>(dst);
+  const auto *s = static_cast<const unsigned char *>(src);
+
+  // Plain stores up to the first 64-byte boundary of dst
+  const std::size_t head = std::min<std::size_t>(
+      (64 - reinterpret_cast<std::uintptr_t>(d) % 64) % 64, bytes);
+  std::memcpy(d, s, head);
+  std::size_t done = head;
+  done += detail::stream_kernel()(d + done, s + done, bytes - done);
+  std::memcpy(d + done, s + done, bytes - done);
+  _mm_sfence();
+#else
+  std::memcpy(dst, src, bytes);
+#endif
+}
+} // namespace yy
@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+#include <BufferGroup.hpp>
+
+#include <atomic>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+using Symbols = std::vector<std::string>;
+using Limits = std::map<std::string, long>;
+using Group = yy::BufferGroup<Symbols, Limits, int>;
+}
+
+TEST(BufferGroupTests, PublishesMembersTogether) {
+    Group group(Symbols{"AAPL"}, Limits{{"AAPL", 100}}, 1);
+    const auto before = group.pin();
+
+    group.publish([](Group::Transaction& t) {
+        t.update<0>([](Symbols& s) { s.push_back("MSFT"); });
+        t.update<1>([](Limits& l) { l["MSFT"] = 200; });
+    });
+    const auto after = group.pin();
+
+    EXPECT_EQ(before.get<0>().size(), 1u);
+    EXPECT_EQ(before.get<1>().count("MSFT"), 0u);
+    EXPECT_EQ(after.get<0>().size(), 2u);
+    EXPECT_EQ(after.get<1>().at("MSFT"), 200);
+    EXPECT_EQ(after.generation(), before.generation() + 1);
+
+    // The untouched member is shared, not copied
+    EXPECT_TRUE(Group::shares<2>(before, after));
+    EXPECT_FALSE(Group::shares<0>(before, after));
+
+    group.write<2>(7);
+    EXPECT_EQ(group.read<2>(), 7);
+    EXPECT_EQ(group.read<0>().size(), 2u);
+    EXPECT_EQ(group.visit([](const Symbols& s, const Limits& l, int v) {
+        return s.size() + l.size() + v;
+    }), 11u);
+}
+
+TEST(BufferGroupTests, ReadersNeverSeeMixedVersions) {
+    yy::BufferGroup<std::string, std::vector<int>> group("0", std::vector<int>{0});
+    std::atomic<bool> done{false};
+    std::atomic<long> mismatches{0};
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; ++r) {
+        readers.emplace_back([&] {
+            while (!done.load(std::memory_order_relaxed)) {
+                const auto view = group.pin();
+                if (view.get<0>() != std::to_string(view.get<1>().back())) {
+                    mismatches.fetch_add(1);
+                }
+            }
+        });
+    }
+    for (int i = 1; i <= 5000; ++i) {
+        group.publish([i](auto& t) {
+            t.template set<0>(std::to_string(i));
+            t.template set<1>(std::vector<int>{i});
+        });
+    }
+    done = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    EXPECT_EQ(mismatches.load(), 0);
+    EXPECT_EQ(group.generation(), 5000u);
+}
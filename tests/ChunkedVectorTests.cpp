@@ -0,0 +1,62 @@
+#include "ChunkedVector.hpp"
+#include "DoubleBuffer.hpp"
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using Table = yy::ChunkedVector<int>;
+
+TEST(ChunkedVectorTests, CopyOnWrite) {
+    Table a(10000, 1);
+    Table b = a;
+    EXPECT_EQ(a.shared_chunks(b), a.chunk_count());
+    b.set(5, 2);
+    EXPECT_EQ(a[5], 1);
+    EXPECT_EQ(b[5], 2);
+    EXPECT_EQ(a.shared_chunks(b), a.chunk_count() - 1);
+    b.push_back(3);
+    EXPECT_EQ(b.size(), 10001u);
+    EXPECT_EQ(b[10000], 3);
+}
+
+TEST(ChunkedVectorTests, BuffersShareUnchangedChunks) {
+    yy::DoubleBuffer<Table> buffer(Table(1 << 20, 0));
+    auto before = buffer.snapshot();
+
+    buffer.update([](Table& t) { t.set(123456, 7); });
+    auto after = buffer.snapshot();
+
+    EXPECT_EQ((*before)[123456], 0);
+    EXPECT_EQ((*after)[123456], 7);
+    EXPECT_EQ(after->shared_chunks(*before), after->chunk_count() - 1);
+}
+
+TEST(ChunkedVectorTests, ConcurrentReadersSeeWholeVersions) {
+    constexpr std::size_t kSize = 64 * Table::chunk_size;
+    yy::DoubleBuffer<Table> buffer(Table(kSize, 0));
+    std::atomic<bool> running{true};
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 4; ++r) {
+        readers.emplace_back([&] {
+            while (running) {
+                buffer.visit([](const Table& t) {
+                    // Every update bumps one element per chunk
+                    const int first = t[0];
+                    for (std::size_t i = 0; i < t.size(); i += Table::chunk_size) {
+                        EXPECT_EQ(t[i], first);
+                    }
+                });
+            }
+        });
+    }
+    for (int v = 1; v <= 500; ++v) {
+        buffer.update([v](Table& t) {
+            for (std::size_t i = 0; i < t.size(); i += Table::chunk_size) t.set(i, v);
+        });
+    }
+    running = false;
+    for (auto& t : readers) t.join();
+    EXPECT_EQ(buffer.snapshot()->operator[](kSize - Table::chunk_size), 500);
+}
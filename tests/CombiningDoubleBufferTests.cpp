@@ -0,0 +1,36 @@
+#include "CombiningDoubleBuffer.hpp"
+
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(CombiningDoubleBufferTests, InitialValue) {
+    yy::CombiningDoubleBuffer<std::string> buffer("init");
+    EXPECT_EQ(buffer.read(), "init");
+}
+
+TEST(CombiningDoubleBufferTests, WriteThenUpdate) {
+    yy::CombiningDoubleBuffer<std::string> buffer("init");
+    buffer.write("updated");
+    buffer.update([](std::string& s) { s += "!"; });
+    EXPECT_EQ(buffer.read(), "updated!");
+}
+
+TEST(CombiningDoubleBufferTests, ConcurrentUpdatesAreNotLost) {
+    constexpr int kWriters = 8;
+    constexpr int kUpdatesPerWriter = 2000;
+    yy::CombiningDoubleBuffer<std::vector<int>> buffer(std::vector<int>(kWriters, 0));
+
+    std::vector<std::thread> writers;
+    for (int w = 0; w < kWriters; ++w) {
+        writers.emplace_back([&, w] {
+            for (int i = 0; i < kUpdatesPerWriter; ++i) {
+                buffer.update([w](std::vector<int>& counts) { ++counts[w]; });
+            }
+        });
+    }
+    for (auto& t : writers) t.join();
+
+    EXPECT_EQ(buffer.read(), std::vector<int>(kWriters, kUpdatesPerWriter));
+}
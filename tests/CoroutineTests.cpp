@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+#include <DoubleBuffer.hpp>
+
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <string>
+#include <vector>
+
+namespace {
+// Minimal fire-and-forget coroutine for the tests
+struct Task {
+    struct promise_type {
+        Task get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+Task watch(yy::DoubleBuffer<std::string>& buffer, int updates,
+           std::vector<std::pair<std::uint64_t, std::string>>& seen) {
+    std::uint64_t generation = buffer.generation();
+    for (int i = 0; i < updates; ++i) {
+        generation = co_await buffer.next_update(generation);
+        seen.emplace_back(generation, buffer.read());
+    }
+}
+
+struct Queue {
+    std::deque<std::coroutine_handle<>> ready;
+
+    void run() {
+        while (!ready.empty()) {
+            auto handle = ready.front();
+            ready.pop_front();
+            handle.resume();
+        }
+    }
+};
+
+Task watch_on(yy::DoubleBuffer<std::string>& buffer, Queue& queue, std::uint64_t& last) {
+    last = co_await buffer.next_update(
+        buffer.generation(), [&queue](std::coroutine_handle<> h) { queue.ready.push_back(h); });
+}
+} // namespace
+
+TEST(CoroutineTests, ResumesOnTheWriterThread) {
+    yy::DoubleBuffer<std::string> buffer("0");
+    std::vector<std::pair<std::uint64_t, std::string>> first, second;
+    watch(buffer, 3, first);
+    watch(buffer, 1, second);
+    EXPECT_TRUE(first.empty());
+
+    buffer.write("1");
+    buffer.write("2");
+    buffer.write("3");
+    ASSERT_EQ(first.size(), 3u);
+    EXPECT_EQ(first[0], std::make_pair(std::uint64_t{1}, std::string("1")));
+    EXPECT_EQ(first[2], std::make_pair(std::uint64_t{3}, std::string("3")));
+    ASSERT_EQ(second.size(), 1u);
+    EXPECT_EQ(second[0].first, 1u);
+}
+
+TEST(CoroutineTests, CompletesImmediatelyWhenAlreadyNewer) {
+    yy::DoubleBuffer<std::string> buffer("0");
+    buffer.write("1");
+    std::vector<std::pair<std::uint64_t, std::string>> seen;
+    [&]() -> Task {
+        seen.emplace_back(co_await buffer.next_update(0), "");
+    }();
+    ASSERT_EQ(seen.size(), 1u);
+    EXPECT_EQ(seen[0].first, 1u);
+}
+
+TEST(CoroutineTests, ResumesOnTheExecutor) {
+    yy::DoubleBuffer<std::string> buffer("0");
+    Queue queue;
+    std::uint64_t last = 0;
+    watch_on(buffer, queue, last);
+    buffer.write("1");
+    EXPECT_EQ(last, 0u);
+    ASSERT_EQ(queue.ready.size(), 1u);
+    queue.run();
+    EXPECT_EQ(last, 1u);
+}
@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+#include <DoubleBufferArray.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+struct Quote {
+    std::int64_t bid;
+    std::int64_t ask;
+    std::int64_t sequence;
+    std::int64_t check;
+};
+}
+
+TEST(DoubleBufferArrayTests, SlotsAreIndependent) {
+    auto slots = std::make_unique<yy::DoubleBufferArray<Quote, 50000>>(Quote{1, 2, 0, 0});
+    EXPECT_EQ(slots->size(), 50000u);
+    slots->write(7, Quote{10, 11, 1, 0});
+    slots->write(7, Quote{12, 13, 2, 0});
+    slots->write(49999, Quote{20, 21, 1, 0});
+
+    EXPECT_EQ(slots->read(7).bid, 12);
+    EXPECT_EQ(slots->read(49999).ask, 21);
+    EXPECT_EQ(slots->read(8).bid, 1);
+    EXPECT_EQ(slots->version(7), 2u);
+    EXPECT_EQ(slots->version(8), 0u);
+
+    const std::vector<std::size_t> indices{8, 7, 49999, 7};
+    const auto values = slots->read_many(indices);
+    ASSERT_EQ(values.size(), 4u);
+    EXPECT_EQ(values[0].bid, 1);
+    EXPECT_EQ(values[1].bid, 12);
+    EXPECT_EQ(values[2].bid, 20);
+    EXPECT_EQ(values[3].sequence, 2);
+
+    const std::size_t batch[] = {1, 2, 3};
+    const Quote quotes[] = {{1, 1, 1, 0}, {2, 2, 1, 0}, {3, 3, 1, 0}};
+    slots->write_many(batch, quotes, 3);
+    for (std::size_t i = 1; i <= 3; ++i) {
+        EXPECT_EQ(slots->read(i).bid, static_cast<std::int64_t>(i));
+        EXPECT_EQ(slots->version(i), 1u);
+    }
+}
+
+TEST(DoubleBufferArrayTests, ReadersNeverSeeTornSlots) {
+    constexpr std::size_t kSlots = 256;
+    auto slots = std::make_unique<yy::DoubleBufferArray<Quote, kSlots>>();
+    std::atomic<bool> done{false};
+    std::atomic<long> torn{0};
+
+    std::vector<std::size_t> all(kSlots);
+    for (std::size_t i = 0; i < kSlots; ++i) {
+        all[i] = i;
+    }
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; ++r) {
+        readers.emplace_back([&, r] {
+            std::vector<Quote> out(kSlots);
+            while (!done.load(std::memory_order_relaxed)) {
+                if (r == 0) {
+                    const Quote q = slots->read(r);
+                    torn += q.bid + q.ask + q.sequence != q.check;
+                } else {
+                    slots->read_many(all.data(), all.size(), out.data());
+                    for (const Quote& q : out) {
+                        torn += q.bid + q.ask + q.sequence != q.check;
+                    }
+                }
+            }
+        });
+    }
+    for (std::int64_t n = 1; n <= 200000; ++n) {
+        const std::size_t i = static_cast<std::size_t>(n) % kSlots;
+        slots->write(i, Quote{n, 2 * n, n, 4 * n});
+        if (n % 1000 == 0) {
+            const Quote batch[] = {{n, n, n, 3 * n}, {n, 0, 0, n}};
+            slots->write_many(all.data(), batch, 2);
+        }
+    }
+    done = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    EXPECT_EQ(torn.load(), 0);
+}
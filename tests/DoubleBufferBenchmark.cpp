@@ -163,4 +163,45 @@ TEST_F(DoubleBufferTest, ReadAndWriteString) {
     for (auto& t : readers) t.join();
 
     EXPECT_EQ(valid_reads.load(), kIterations);
-}
\ No newline at end of file
+}
+
+// Layout benchmark: concurrent readers bump ref_count while copying TestData.
+// With the default layout the counter shares a cache line with the tail of
+// the data, with Isolated it sits on its own line.
+template<typename Storage>
+double concurrent_read_throughput(int threads, int reads_per_thread) {
+    yy::DoubleBuffer<TestData, Storage> layout_buffer{TestData(1)};
+    std::atomic<bool> start{false};
+    std::vector<std::thread> readers;
+    for (int i = 0; i < threads; ++i) {
+        readers.emplace_back([&] {
+            while (!start) std::this_thread::yield();
+            for (int n = 0; n < reads_per_thread; ++n) {
+                auto val = layout_buffer.read();
+                if (val.data[kValueSize - 1] != 1) std::abort();
+            }
+        });
+    }
+    PerfTimer timer;
+    start = true;
+    for (auto& t : readers) t.join();
+    return threads * reads_per_thread / timer.elapsed();
+}
+
+TEST(LayoutBenchmark, CounterFalseSharing) {
+    constexpr int kThreads = 4;
+    const double shared = concurrent_read_throughput<yy::Buffered>(kThreads, kIterations);
+    const double isolated64 = concurrent_read_throughput<yy::Isolated<64>>(kThreads, kIterations);
+    const double isolated128 = concurrent_read_throughput<yy::Isolated<128>>(kThreads, kIterations);
+
+    std::cout << "Concurrent read throughput (" << kThreads << " threads)\n"
+              << "  counters next to data:   " << shared << " ops/sec ("
+              << sizeof(yy::DoubleBuffer<TestData, yy::Buffered>) << " bytes)\n"
+              << "  counters isolated (64):  " << isolated64 << " ops/sec ("
+              << sizeof(yy::DoubleBuffer<TestData, yy::Isolated<64>>) << " bytes)\n"
+              << "  counters isolated (128): " << isolated128 << " ops/sec ("
+              << sizeof(yy::DoubleBuffer<TestData, yy::Isolated<128>>) << " bytes)\n";
+    EXPECT_GT(shared, 0);
+    EXPECT_GT(isolated64, 0);
+    EXPECT_GT(isolated128, 0);
+}
@@ -1,6 +1,26 @@
 #include <gtest/gtest.h>
 #include <DoubleBuffer.hpp>
 
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
 TEST(BasicTests, InitialValue) {
     yy::DoubleBuffer<int> buffer(42);
     EXPECT_EQ(buffer.read(), 42);
@@ -11,4 +31,544 @@ TEST(BasicTests, WriteReadConsistency) {
     EXPECT_EQ(buffer.read(), "init");
     buffer.write("updated");
     EXPECT_EQ(buffer.read(), "updated");
-}
\ No newline at end of file
+}
+
+TEST(SnapshotTests, SurvivesWrites) {
+    yy::DoubleBuffer<std::string> buffer("v0");
+    auto snapshot = buffer.snapshot();
+    for (int i = 1; i <= 10; ++i) {
+        buffer.write("v" + std::to_string(i)); // Must not wait for the snapshot
+    }
+    EXPECT_EQ(*snapshot, "v0");
+    EXPECT_EQ(buffer.read(), "v10");
+
+    auto copy = snapshot;
+    snapshot = buffer.snapshot();
+    EXPECT_EQ(*copy, "v0");
+    EXPECT_EQ(*snapshot, "v10");
+}
+
+TEST(SnapshotTests, SeveralVersionsPinned) {
+    yy::DoubleBuffer<std::string> buffer("v0");
+    std::vector<yy::DoubleBuffer<std::string>::Snapshot> snapshots;
+    for (int i = 1; i <= 8; ++i) {
+        buffer.write("v" + std::to_string(i));
+        snapshots.push_back(buffer.snapshot());
+    }
+    for (int i = 1; i <= 8; ++i) {
+        EXPECT_EQ(*snapshots[i - 1], "v" + std::to_string(i));
+    }
+    snapshots.clear();
+    for (int i = 0; i < 4; ++i) {
+        buffer.write("w" + std::to_string(i));
+    }
+    EXPECT_EQ(buffer.read(), "w3");
+}
+
+TEST(SnapshotTests, ConcurrentSnapshotsDuringWrites) {
+    yy::DoubleBuffer<std::vector<int>> buffer(std::vector<int>(64, 0));
+    std::atomic<bool> running{true};
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; ++i) {
+        readers.emplace_back([&] {
+            while (running) {
+                auto snapshot = buffer.snapshot();
+                const int first = snapshot->front();
+                std::this_thread::yield();
+                EXPECT_EQ(*snapshot, std::vector<int>(64, first));
+            }
+        });
+    }
+    for (int i = 1; i <= 2000; ++i) {
+        buffer.write(std::vector<int>(64, i));
+    }
+    running = false;
+    for (auto& t : readers) t.join();
+    EXPECT_EQ(buffer.read(), std::vector<int>(64, 2000));
+}
+
+TEST(SnapshotTests, RetiredSlotsOutliveStaleReaders) {
+    // Each cycle moves a pinned buffer out of rotation and lets it go, while
+    // readers keep loading read pointers that may already be stale
+    yy::DoubleBuffer<std::vector<int>> buffer(std::vector<int>(16, 0));
+    std::atomic<bool> running{true};
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; ++i) {
+        readers.emplace_back([&] {
+            while (running) {
+                const auto value = buffer.read();
+                EXPECT_EQ(value, std::vector<int>(16, value.front()));
+            }
+        });
+    }
+    for (int i = 1; i <= 2000; i += 2) {
+        auto snapshot = buffer.snapshot();
+        buffer.write(std::vector<int>(16, i));
+        buffer.write(std::vector<int>(16, i + 1));
+    }
+    running = false;
+    for (auto& t : readers) t.join();
+    EXPECT_EQ(buffer.read(), std::vector<int>(16, 2000));
+}
+
+struct Threshold {
+    int low;
+    int high;
+};
+
+TEST(SingleAtomicTests, SmallTypesUseOneAtomic) {
+    static_assert(std::is_same_v<yy::default_storage_t<int>, yy::SingleAtomic>);
+    static_assert(std::is_same_v<yy::default_storage_t<Threshold>, yy::SingleAtomic>);
+    static_assert(std::is_same_v<yy::default_storage_t<std::string>, yy::Buffered>);
+    EXPECT_EQ(sizeof(yy::DoubleBuffer<Threshold>), sizeof(std::atomic<Threshold>));
+}
+
+TEST(SingleAtomicTests, ReadWriteUpdate) {
+    yy::DoubleBuffer<Threshold> buffer(Threshold{1, 2});
+    EXPECT_EQ(buffer.read().high, 2);
+    buffer.write(Threshold{3, 4});
+    buffer.update([](Threshold& t) { t.high += 10; });
+    const auto snapshot = buffer.snapshot();
+    EXPECT_EQ(snapshot->low, 3);
+    EXPECT_EQ(snapshot->high, 14);
+}
+
+TEST(SingleAtomicTests, BufferedPolicyCanBeForced) {
+    yy::DoubleBuffer<int, yy::Buffered> buffer(1);
+    buffer.write(2);
+    EXPECT_EQ(buffer.read(), 2);
+    EXPECT_GE(sizeof(buffer), 128u);
+}
+
+struct MoveOnlyIndex {
+    std::unique_ptr<int> payload;
+    explicit MoveOnlyIndex(int v) : payload(std::make_unique<int>(v)) {}
+};
+
+struct LockedIndex {
+    std::mutex mutex;
+    int value;
+    explicit LockedIndex(int v) : value(v) {}
+};
+
+TEST(IndirectTests, MoveOnlyTypeDefaultsToIndirect) {
+    static_assert(std::is_same_v<yy::default_storage_t<MoveOnlyIndex>, yy::Indirect>);
+
+    yy::DoubleBuffer<MoveOnlyIndex> buffer(std::make_unique<MoveOnlyIndex>(1));
+    EXPECT_EQ(buffer.visit([](const MoveOnlyIndex& index) { return *index.payload; }), 1);
+
+    buffer.emplace(2);
+    auto recycled = buffer.write(std::make_unique<MoveOnlyIndex>(3));
+    ASSERT_NE(recycled, nullptr);
+    EXPECT_EQ(*recycled->payload, 1); // Published two writes ago
+
+    // A pinned object is left alone, the writer moves to a fresh slot
+    auto pinned = buffer.snapshot();
+    buffer.emplace(4);
+    EXPECT_EQ(buffer.write(std::make_unique<MoveOnlyIndex>(5)), nullptr);
+    EXPECT_EQ(*pinned->payload, 3);
+    EXPECT_EQ(*buffer.snapshot()->payload, 5);
+}
+
+TEST(IndirectTests, NonMovableType) {
+    yy::DoubleBuffer<LockedIndex> buffer(std::make_unique<LockedIndex>(1));
+    for (int i = 2; i <= 5; ++i) {
+        buffer.emplace(i);
+    }
+    EXPECT_EQ(buffer.snapshot()->value, 5);
+}
+
+TEST(IndirectTests, CopyableTypeCanOptIn) {
+    yy::DoubleBuffer<std::string, yy::Indirect> buffer("init");
+    buffer.update([](std::string& s) { s += "!"; });
+    buffer.write(std::make_unique<std::string>("moved"));
+    buffer.write("copied");
+    EXPECT_EQ(buffer.read(), "copied");
+}
+
+TEST(IndirectTests, PointerOverloadsOnlyForIndirect) {
+    // Braced values must not be ambiguous with the unique_ptr overloads
+    yy::DoubleBuffer<std::vector<int>> vectors({});
+    vectors.write({});
+    vectors.write({1, 2});
+    EXPECT_EQ(vectors.read(), (std::vector<int>{1, 2}));
+
+    yy::DoubleBuffer<std::string> strings("init");
+    strings.write({});
+    EXPECT_EQ(strings.read(), "");
+}
+
+// Upstream resource that tracks how many bytes are outstanding
+class CountingResource : public std::pmr::memory_resource {
+public:
+    std::size_t outstanding = 0;
+    std::size_t allocations = 0;
+
+private:
+    void* do_allocate(std::size_t bytes, std::size_t align) override {
+        outstanding += bytes;
+        ++allocations;
+        return std::pmr::new_delete_resource()->allocate(bytes, align);
+    }
+    void do_deallocate(void* p, std::size_t bytes, std::size_t align) override {
+        outstanding -= bytes;
+        std::pmr::new_delete_resource()->deallocate(p, bytes, align);
+    }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+};
+
+TEST(AllocatorTests, BuffersAllocateFromArenas) {
+    using Table = std::pmr::vector<std::pmr::string>;
+    CountingResource upstream;
+    {
+        yy::DoubleBuffer<Table> buffer(Table{}, &upstream);
+        const std::size_t baseline = upstream.allocations;
+
+        Table next;
+        for (int i = 0; i < 100; ++i) {
+            next.emplace_back("a fairly long string that will not fit SSO #" + std::to_string(i));
+        }
+        buffer.write(next);
+        EXPECT_GT(upstream.allocations, baseline);
+        EXPECT_EQ(buffer.read(), next);
+
+        // Arenas are reset on every rebuild, so memory stays bounded
+        buffer.write(next);
+        const std::size_t steady = upstream.outstanding;
+        for (int i = 0; i < 50; ++i) {
+            buffer.update([](Table& t) { t.back() += "!"; });
+            buffer.write(next);
+        }
+        EXPECT_LE(upstream.outstanding, steady * 2);
+
+        auto pinned = buffer.snapshot();
+        buffer.write(Table(3));
+        buffer.write(Table(4));
+        EXPECT_EQ(*pinned, next);
+        EXPECT_EQ(buffer.read().size(), 4u);
+    }
+    EXPECT_EQ(upstream.outstanding, 0u);
+}
+
+namespace {
+struct Quotes {
+    int bid[64];
+    int ask[64];
+    long sequence;
+};
+}
+
+TEST(DirtyRangeTests, AlternatingWritesStayConsistent) {
+    using Buffer = yy::DoubleBuffer<Quotes, yy::Buffered>;
+    Quotes expected{};
+    Buffer buffer(expected);
+
+    for (int i = 0; i < 100; ++i) {
+        const int level = i % 64;
+        expected.bid[level] = i;
+        expected.sequence = i;
+        buffer.write_ranges(expected, {yy::byte_range(expected, expected.bid[level]),
+                                       yy::byte_range(expected, expected.sequence)});
+        const Quotes actual = buffer.read();
+        ASSERT_EQ(std::memcmp(&actual, &expected, sizeof(Quotes)), 0) << "write " << i;
+    }
+}
+
+TEST(DirtyRangeTests, OnlyMarkedBytesAreCopied) {
+    yy::DoubleBuffer<Quotes, yy::Buffered> buffer(Quotes{});
+
+    // Bytes outside the ranges are not read, the buffers keep their own
+    Quotes garbage;
+    std::memset(&garbage, 0xff, sizeof(garbage));
+    garbage.ask[3] = 7;
+    buffer.write_ranges(garbage, {yy::byte_range(garbage, garbage.ask[3])});
+    Quotes other = garbage;
+    other.ask[4] = 8;
+    buffer.write_ranges(other, {yy::byte_range(other, other.ask[4])});
+
+    const Quotes actual = buffer.read();
+    EXPECT_EQ(actual.ask[3], 7);
+    EXPECT_EQ(actual.ask[4], 8);
+    EXPECT_EQ(actual.ask[5], 0);
+    EXPECT_EQ(actual.bid[0], 0);
+    EXPECT_EQ(actual.sequence, 0);
+}
+
+TEST(DirtyRangeTests, FallsBackToFullCopy) {
+    yy::DoubleBuffer<Quotes, yy::Buffered> buffer(Quotes{});
+    Quotes expected{};
+
+    // write() leaves no dirty ranges behind
+    expected.bid[1] = 1;
+    buffer.write_ranges(expected, {yy::byte_range(expected, expected.bid[1])});
+    expected.bid[2] = 2;
+    buffer.write(expected);
+    expected.bid[3] = 3;
+    buffer.write_ranges(expected, {yy::byte_range(expected, expected.bid[3])});
+    Quotes actual = buffer.read();
+    EXPECT_EQ(std::memcmp(&actual, &expected, sizeof(Quotes)), 0);
+
+    // A pinned back buffer is replaced by a fresh copy of the current value
+    auto pinned = buffer.snapshot();
+    expected.ask[0] = 4;
+    buffer.write_ranges(expected, {yy::byte_range(expected, expected.ask[0])});
+    expected.ask[1] = 5;
+    buffer.write_ranges(expected, {yy::byte_range(expected, expected.ask[1])});
+    expected.ask[2] = 6;
+    std::vector<yy::ByteRange> ranges{yy::byte_range(expected, expected.ask[2])};
+    buffer.write_ranges(expected, ranges);
+    actual = buffer.read();
+    EXPECT_EQ(std::memcmp(&actual, &expected, sizeof(Quotes)), 0);
+    EXPECT_EQ(pinned->bid[3], 3);
+    EXPECT_EQ(pinned->ask[0], 0);
+}
+
+TEST(WaitForUpdateTests, GenerationCountsPublishes) {
+    yy::DoubleBuffer<std::string> buffer("a");
+    EXPECT_EQ(buffer.generation(), 0u);
+    buffer.write("b");
+    buffer.update([](std::string& s) { s += "c"; });
+    EXPECT_EQ(buffer.generation(), 2u);
+    EXPECT_EQ(buffer.snapshot().generation(), 2u);
+    EXPECT_EQ(buffer.wait_for_update(1), 2u);
+}
+
+TEST(WaitForUpdateTests, TimesOutWithoutPublish) {
+    yy::DoubleBuffer<std::string> buffer("a");
+    const auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(buffer.wait_for_update(0, std::chrono::milliseconds(20)), 0u);
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(20));
+}
+
+TEST(WaitForUpdateTests, HugeTimeoutWaitsForThePublish) {
+    yy::DoubleBuffer<std::string> buffer("a");
+    std::thread writer([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        buffer.write("b");
+    });
+    // Must saturate rather than overflow into a deadline in the past
+    EXPECT_EQ(buffer.wait_for_update(0, std::chrono::hours::max()), 1u);
+    writer.join();
+    EXPECT_EQ(buffer.read(), "b");
+}
+
+TEST(WaitForUpdateTests, CountedAtomicCountsWrites) {
+    yy::DoubleBuffer<int, yy::CountedAtomic> flag(0);
+    EXPECT_EQ(flag.wait_for_update(0, std::chrono::milliseconds(1)), 0u);
+
+    std::thread writer([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        flag.write(1);
+    });
+    EXPECT_EQ(flag.wait_for_update(0), 1u);
+    EXPECT_EQ(flag.read(), 1);
+    writer.join();
+    flag.update([](int& value) { ++value; });
+    EXPECT_EQ(flag.generation(), 2u);
+}
+
+TEST(WaitForUpdateTests, WakesOnPublish) {
+    yy::DoubleBuffer<std::string> buffer("0");
+    constexpr int kWrites = 1000;
+
+    std::vector<std::thread> waiters;
+    std::atomic<int> finished{0};
+    for (int i = 0; i < 4; ++i) {
+        waiters.emplace_back([&] {
+            std::uint64_t seen = 0;
+            while (seen < kWrites) {
+                const std::uint64_t next = buffer.wait_for_update(seen);
+                ASSERT_GT(next, seen);
+                const auto pinned = buffer.snapshot();
+                ASSERT_GE(pinned.generation(), next);
+                ASSERT_EQ(*pinned, std::to_string(pinned.generation()));
+                seen = next;
+            }
+            finished.fetch_add(1);
+        });
+    }
+    for (int i = 1; i <= kWrites; ++i) {
+        buffer.write(std::to_string(i));
+    }
+    for (auto& waiter : waiters) {
+        waiter.join();
+    }
+    EXPECT_EQ(finished.load(), 4);
+}
+
+namespace {
+struct Recorder {
+    std::mutex mutex;
+    std::vector<std::pair<std::uint64_t, std::string>> seen;
+
+    static void record(void* context, std::uint64_t generation,
+                       const yy::DoubleBuffer<std::string>::Snapshot& view) {
+        auto* self = static_cast<Recorder*>(context);
+        std::lock_guard<std::mutex> lock(self->mutex);
+        self->seen.emplace_back(generation, *view);
+    }
+};
+}
+
+TEST(ObserverTests, WriterThreadObserversSeeEveryPublish) {
+    using Buffer = yy::DoubleBuffer<std::string>;
+    Buffer buffer("0");
+    Recorder recorder;
+    const std::size_t id = buffer.subscribe(&Recorder::record, &recorder);
+
+    buffer.write("1");
+    buffer.update([](std::string& s) { s += "2"; });
+    ASSERT_EQ(recorder.seen.size(), 2u);
+    EXPECT_EQ(recorder.seen[0], std::make_pair(std::uint64_t{1}, std::string("1")));
+    EXPECT_EQ(recorder.seen[1], std::make_pair(std::uint64_t{2}, std::string("12")));
+
+    buffer.unsubscribe(id);
+    buffer.write("3");
+    EXPECT_EQ(recorder.seen.size(), 2u);
+}
+
+TEST(ObserverTests, NotifierThreadCoalescesToLatest) {
+    using Buffer = yy::DoubleBuffer<std::string>;
+    Buffer buffer("0");
+    Recorder recorder;
+    buffer.subscribe(&Recorder::record, &recorder, Buffer::Dispatch::notifier);
+
+    constexpr int kWrites = 200;
+    for (int i = 1; i <= kWrites; ++i) {
+        buffer.write(std::to_string(i));
+    }
+    for (int spins = 0; spins < 5000; ++spins) {
+        {
+            std::lock_guard<std::mutex> lock(recorder.mutex);
+            if (!recorder.seen.empty() && recorder.seen.back().first == kWrites) {
+                break;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    std::lock_guard<std::mutex> lock(recorder.mutex);
+    ASSERT_FALSE(recorder.seen.empty());
+    EXPECT_EQ(recorder.seen.back().first, std::uint64_t{kWrites});
+    std::uint64_t previous = 0;
+    for (const auto& [generation, value] : recorder.seen) {
+        EXPECT_GT(generation, previous);
+        EXPECT_EQ(value, std::to_string(generation));
+        previous = generation;
+    }
+}
+
+TEST(ObserverTests, CapacityIsBounded) {
+    yy::DoubleBuffer<std::string> buffer("0");
+    Recorder recorder;
+    for (std::size_t i = 0; i < yy::DoubleBuffer<std::string>::kMaxObservers; ++i) {
+        buffer.subscribe(&Recorder::record, &recorder);
+    }
+    EXPECT_THROW(buffer.subscribe(&Recorder::record, &recorder), std::length_error);
+    buffer.write("1");
+    EXPECT_EQ(recorder.seen.size(), yy::DoubleBuffer<std::string>::kMaxObservers);
+}
+
+TEST(ObserverTests, SlowNotifierObserversDoNotStallTheWriter) {
+    using Buffer = yy::DoubleBuffer<std::string>;
+    Buffer buffer("v0");
+    std::atomic<int> calls{0};
+    const auto id = buffer.subscribe(
+        [](void* context, std::uint64_t, const Buffer::Snapshot&) {
+            static_cast<std::atomic<int>*>(context)->fetch_add(1);
+            std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        },
+        &calls, Buffer::Dispatch::notifier);
+
+    buffer.write("v1");
+    while (calls.load() == 0) std::this_thread::yield();
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 2; i <= 4; ++i) {
+        buffer.write("v" + std::to_string(i));
+    }
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(100));
+    EXPECT_EQ(buffer.read(), "v4");
+    buffer.unsubscribe(id);
+}
+
+TEST(EventFdTests, PublishesAccumulateInTheCounter) {
+    yy::DoubleBuffer<std::string> buffer("0");
+    EXPECT_EQ(buffer.native_handle(), -1);
+    const int fd = buffer.enable_eventfd();
+    ASSERT_GE(fd, 0);
+    EXPECT_EQ(buffer.enable_eventfd(), fd);
+    EXPECT_EQ(buffer.native_handle(), fd);
+
+    pollfd readable{fd, POLLIN, 0};
+    EXPECT_EQ(::poll(&readable, 1, 0), 0);
+
+    buffer.write("1");
+    buffer.write("2");
+    buffer.update([](std::string& s) { s += "3"; });
+    EXPECT_EQ(::poll(&readable, 1, 0), 1);
+
+    eventfd_t count = 0;
+    ASSERT_EQ(::eventfd_read(fd, &count), 0);
+    EXPECT_EQ(count, 3u);
+    EXPECT_EQ(::poll(&readable, 1, 0), 0);
+}
+
+TEST(EventFdTests, WakesEpollFromAnotherThread) {
+    yy::DoubleBuffer<std::string> buffer("0");
+    const int fd = buffer.enable_eventfd();
+    const int epoll = ::epoll_create1(EPOLL_CLOEXEC);
+    ASSERT_GE(epoll, 0);
+    epoll_event interest{};
+    interest.events = EPOLLIN;
+    ASSERT_EQ(::epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &interest), 0);
+
+    std::thread writer([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        buffer.write("1");
+    });
+    epoll_event ready{};
+    EXPECT_EQ(::epoll_wait(epoll, &ready, 1, 5000), 1);
+    writer.join();
+    eventfd_t count = 0;
+    EXPECT_EQ(::eventfd_read(fd, &count), 0);
+    EXPECT_EQ(buffer.read(), "1");
+    ::close(epoll);
+}
+
+TEST(TimestampTests, SnapshotsCarryPublishTime) {
+    yy::DoubleBuffer<std::string> buffer("0");
+    const auto initial = buffer.snapshot().published();
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    const auto before = std::chrono::steady_clock::now();
+    buffer.write("1");
+    const auto after = std::chrono::steady_clock::now();
+
+    const auto pinned = buffer.snapshot();
+    EXPECT_GE(pinned.published(), before);
+    EXPECT_LE(pinned.published(), after);
+    EXPECT_GT(pinned.published(), initial);
+}
+
+TEST(TimestampTests, StaleReadsComeFromTheThreadCache) {
+    yy::DoubleBuffer<std::string> a("a0");
+    yy::DoubleBuffer<std::string> b("b0");
+    const auto long_enough = std::chrono::hours(1);
+
+    EXPECT_EQ(a.read_stale_ok(long_enough), "a0");
+    EXPECT_EQ(b.read_stale_ok(long_enough), "b0");
+    a.write("a1");
+    b.write("b1");
+    // Cached copies are served while young enough, per buffer
+    EXPECT_EQ(a.read_stale_ok(long_enough), "a0");
+    EXPECT_EQ(b.read_stale_ok(long_enough), "b0");
+    EXPECT_EQ(a.read_stale_ok(std::chrono::nanoseconds(0)), "a1");
+    EXPECT_EQ(a.read_stale_ok(long_enough), "a1");
+
+    // Another thread has its own cache
+    std::string other;
+    std::thread reader([&] { other = b.read_stale_ok(long_enough); });
+    reader.join();
+    EXPECT_EQ(other, "b1");
+}
@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+#include <DoubleBufferedMap.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+TEST(DoubleBufferedMapTests, BatchesPublishAsOneVersion) {
+    yy::DoubleBufferedMap<std::string, int> map(
+        std::unordered_map<std::string, int>{{"a", 1}, {"b", 2}});
+    EXPECT_EQ(map.size(), 2u);
+    const auto before = map.pin();
+
+    using Batch = yy::DoubleBufferedMap<std::string, int>::Batch;
+    map.publish(Batch().set("c", 3).erase("a").set("b", 20));
+    map.publish(Batch().set("d", 4));
+    map.publish(Batch().erase("c"));
+
+    const auto after = map.pin();
+    EXPECT_EQ(after.size(), 2u);
+    EXPECT_EQ(after.find("a"), nullptr);
+    EXPECT_EQ(*after.find("b"), 20);
+    EXPECT_FALSE(after.contains("c"));
+    EXPECT_EQ(map.find("d"), 4);
+    EXPECT_EQ(map.find("zz"), std::nullopt);
+
+    // The old pin is untouched
+    EXPECT_EQ(*before.find("a"), 1);
+    EXPECT_EQ(*before.find("b"), 2);
+    EXPECT_EQ(before.size(), 2u);
+}
+
+TEST(DoubleBufferedMapTests, MatchesReferenceMap) {
+    using Map = yy::DoubleBufferedMap<std::uint64_t, std::uint64_t>;
+    Map map;
+    std::unordered_map<std::uint64_t, std::uint64_t> reference;
+    std::mt19937_64 rng(42);
+
+    std::vector<Map::View> pinned;
+    for (int round = 0; round < 300; ++round) {
+        Map::Batch batch;
+        for (int i = 0; i < 50; ++i) {
+            // Multiples of 1024 would cluster in a table keyed by low bits
+            const std::uint64_t key = (rng() % 2000) * 1024;
+            if (rng() % 4 == 0) {
+                batch.erase(key);
+                reference.erase(key);
+            } else {
+                batch.set(key, round);
+                reference[key] = round;
+            }
+        }
+        map.publish(std::move(batch));
+        // Held pins push the writer onto spare buffers now and then
+        if (round % 7 == 0) {
+            pinned.push_back(map.pin());
+        }
+        if (pinned.size() > 3) {
+            pinned.erase(pinned.begin());
+        }
+
+        const auto view = map.pin();
+        ASSERT_EQ(view.size(), reference.size()) << "round " << round;
+        for (const auto& [key, value] : reference) {
+            const auto* found = view.find(key);
+            ASSERT_NE(found, nullptr) << key;
+            ASSERT_EQ(*found, value);
+        }
+        std::size_t visited = 0;
+        view.for_each([&](std::uint64_t key, std::uint64_t value) {
+            ++visited;
+            EXPECT_EQ(reference.at(key), value);
+        });
+        EXPECT_EQ(visited, reference.size());
+    }
+}
+
+TEST(DoubleBufferedMapTests, ConcurrentLookups) {
+    using Map = yy::DoubleBufferedMap<int, int>;
+    Map map;
+    std::atomic<bool> done{false};
+    std::atomic<long> inconsistent{0};
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; ++r) {
+        readers.emplace_back([&] {
+            while (!done.load(std::memory_order_relaxed)) {
+                // Every version maps 0..99 to one round number
+                const auto view = map.pin();
+                const int* first = view.find(0);
+                for (int key = 1; first != nullptr && key < 100; ++key) {
+                    const int* value = view.find(key);
+                    inconsistent += value == nullptr || *value != *first;
+                }
+            }
+        });
+    }
+    for (int round = 0; round < 500; ++round) {
+        Map::Batch batch;
+        for (int key = 0; key < 100; ++key) {
+            batch.set(key, round);
+        }
+        map.publish(std::move(batch));
+    }
+    done = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    EXPECT_EQ(inconsistent.load(), 0);
+    EXPECT_EQ(map.find(50), 499);
+}
@@ -0,0 +1,71 @@
+#include <gtest/gtest.h>
+#include <HistoryBuffer.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(HistoryBufferTests, KeepsTheLastDepthVersions) {
+    yy::HistoryBuffer<std::string> history("v0", 4);
+    EXPECT_THROW(yy::HistoryBuffer<std::string>("x", 1), std::invalid_argument);
+    EXPECT_EQ(*history.latest(), "v0");
+
+    for (int i = 1; i <= 6; ++i) {
+        history.write("v" + std::to_string(i));
+    }
+    history.update([](std::string& s) { s += "!"; });
+    EXPECT_EQ(history.generation(), 7u);
+
+    const auto current = history.latest();
+    const auto previous = history.read_at(current.generation() - 1);
+    EXPECT_EQ(*current, "v6!");
+    ASSERT_TRUE(previous);
+    EXPECT_EQ(*previous, "v6");
+    EXPECT_EQ(*history.read_at(4), "v4");
+    EXPECT_FALSE(history.read_at(3)); // Recycled
+    EXPECT_FALSE(history.read_at(8)); // Not published yet
+}
+
+TEST(HistoryBufferTests, LatestAtOrBeforeTime) {
+    yy::HistoryBuffer<int> history(0, 8);
+    std::vector<yy::HistoryBuffer<int>::Clock::time_point> times;
+    for (int i = 1; i <= 3; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        history.write(i);
+        times.push_back(history.latest().published());
+    }
+    EXPECT_EQ(*history.at_or_before(times[1]), 2);
+    EXPECT_EQ(*history.at_or_before(times[1] + std::chrono::microseconds(500)), 2);
+    EXPECT_EQ(*history.at_or_before(yy::HistoryBuffer<int>::Clock::now()), 3);
+    EXPECT_FALSE(history.at_or_before(times[0] - std::chrono::hours(1)));
+}
+
+TEST(HistoryBufferTests, PinsSurviveConcurrentWrites) {
+    yy::HistoryBuffer<std::string> history("0", 4);
+    std::atomic<bool> done{false};
+    std::atomic<long> errors{0};
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; ++r) {
+        readers.emplace_back([&] {
+            while (!done.load(std::memory_order_relaxed)) {
+                const auto current = history.latest();
+                errors += *current != std::to_string(current.generation());
+                if (const auto previous = history.read_at(current.generation() - 1)) {
+                    errors += *previous != std::to_string(previous.generation());
+                }
+            }
+        });
+    }
+    for (int i = 1; i <= 20000; ++i) {
+        history.write(std::to_string(i));
+    }
+    done = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    EXPECT_EQ(errors.load(), 0);
+}
@@ -0,0 +1,97 @@
+#include "HugePageResource.hpp"
+
+#include <gtest/gtest.h>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <numeric>
+#include <vector>
+
+#include <sys/resource.h>
+
+TEST(HugePageResourceTests, LargeAllocationsAreHugePageAligned) {
+    yy::HugePageResource resource;
+    void* p = resource.allocate(3 << 20, 64);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(p) % yy::kHugePageSize, 0u);
+    resource.deallocate(p, 3 << 20, 64);
+}
+
+TEST(HugePageResourceTests, LargeMappingsAreCached) {
+    yy::HugePageResource resource;
+    auto* p = static_cast<unsigned char*>(resource.allocate(3 << 20, 64));
+    p[0] = 42;
+    resource.deallocate(p, 3 << 20, 64);
+    // Same mapping with its contents, a fresh one would be zeroed
+    auto* q = static_cast<unsigned char*>(resource.allocate(3 << 20, 64));
+    EXPECT_EQ(q, p);
+    EXPECT_EQ(q[0], 42);
+    resource.deallocate(q, 3 << 20, 64);
+}
+
+TEST(HugePageResourceTests, SmallBlocksAreRecycled) {
+    yy::HugePageResource resource;
+    void* p = resource.allocate(1000, 16);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(p) % 1024, 0u);
+    resource.deallocate(p, 1000, 16);
+    // Same size class, so the freed block is handed out again
+    void* q = resource.allocate(700, 8);
+    EXPECT_EQ(q, p);
+    resource.deallocate(q, 700, 8);
+}
+
+TEST(HugePageResourceTests, BacksDoubleBufferArenas) {
+    using Table = std::pmr::vector<double>;
+    yy::HugePageResource resource(yy::HugePageOptions{true, false, false});
+    yy::DoubleBuffer<Table> buffer(Table{}, &resource);
+
+    Table next(1 << 18);
+    std::iota(next.begin(), next.end(), 0.0);
+    buffer.write(next);
+    buffer.write(next);
+    EXPECT_EQ(buffer.read(), next);
+}
+
+static long minor_faults() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_minflt;
+}
+
+TEST(HugePageResourceTests, RepeatedWritesReuseArenaChunks) {
+    using Table = std::pmr::vector<double>;
+    yy::HugePageResource resource(yy::HugePageOptions{false, false, false});
+    yy::DoubleBuffer<Table> buffer(Table{}, &resource);
+
+    Table next(1 << 20); // 8 MB
+    std::iota(next.begin(), next.end(), 0.0);
+    for (int i = 0; i < 4; ++i) {
+        buffer.write(next);
+    }
+    const long before = minor_faults();
+    for (int i = 0; i < 10; ++i) {
+        buffer.write(next);
+    }
+    // Remapping the chunks would fault them in again on each write
+    EXPECT_LT(minor_faults() - before, 10);
+    EXPECT_EQ(buffer.read(), next);
+}
+
+TEST(HugePageResourceTests, InlineBuffersInHugePages) {
+    using Big = std::array<int, 1 << 18>;
+    auto init = std::make_unique<Big>();
+    init->fill(1);
+    auto buffer = yy::make_huge_page_double_buffer<Big>(yy::HugePageOptions{}, *init);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(buffer.get()) % yy::kHugePageSize, 0u);
+
+    init->fill(2);
+    buffer->write(*init);
+    EXPECT_EQ(buffer->visit([](const Big& b) { return b.back(); }), 2);
+
+    // A pinned buffer is swapped for a heap slot, which is in huge pages too
+    auto pinned = buffer->snapshot();
+    buffer->write(*init);
+    buffer->write(*init);
+    const auto* slot = buffer->visit([](const Big& b) { return &b; });
+    EXPECT_LT(reinterpret_cast<std::uintptr_t>(slot) % yy::kHugePageSize, 4096u);
+    EXPECT_EQ(pinned->back(), 2);
+}
@@ -0,0 +1,35 @@
+#include "NumaDoubleBuffer.hpp"
+
+#include <gtest/gtest.h>
+#include <memory_resource>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(NumaDoubleBufferTests, AtLeastOneReplica) {
+    yy::NumaDoubleBuffer<std::string> buffer("init");
+    EXPECT_GE(buffer.replicas(), 1u);
+    EXPECT_EQ(buffer.read(), "init");
+}
+
+TEST(NumaDoubleBufferTests, WriteReachesEveryReplica) {
+    yy::NumaDoubleBuffer<std::vector<int>> buffer({1});
+    buffer.write({1, 2});
+    buffer.update([](std::vector<int>& v) { v.push_back(3); });
+    EXPECT_EQ(buffer.read(), (std::vector<int>{1, 2, 3}));
+    EXPECT_EQ(buffer.visit([](const std::vector<int>& v) { return v.size(); }), 3u);
+}
+
+TEST(NumaDoubleBufferTests, AllocatorAwareContentsOnNodeArenas) {
+    using Table = std::pmr::vector<std::pmr::string>;
+    yy::NumaDoubleBuffer<Table> buffer(Table{});
+    Table next;
+    next.emplace_back("a string long enough to need a heap allocation");
+    buffer.write(next);
+
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; ++i) {
+        readers.emplace_back([&] { EXPECT_EQ(*buffer.snapshot(), next); });
+    }
+    for (auto& t : readers) t.join();
+}
@@ -0,0 +1,52 @@
+#include "ParallelCopy.hpp"
+
+#include <gtest/gtest.h>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <vector>
+
+TEST(ParallelCopyTests, RunVisitsEveryChunkOnce) {
+    yy::CopyPool pool(3);
+    std::vector<std::atomic<int>> hits(1000);
+    for (int round = 0; round < 10; ++round) {
+        pool.run(hits.size(), [&](std::size_t i) { hits[i].fetch_add(1); });
+    }
+    for (auto& h : hits) EXPECT_EQ(h.load(), 10);
+}
+
+TEST(ParallelCopyTests, WriteLargeVector) {
+    yy::CopyPool pool(3);
+    std::vector<int> next(3'000'000);
+    std::iota(next.begin(), next.end(), 0);
+
+    yy::DoubleBuffer<std::vector<int>> buffer(std::vector<int>(10, 7));
+    yy::parallel_write(buffer, next, pool, 64 * 1024);
+    EXPECT_EQ(buffer.read(), next);
+
+    // Shrinking resizes the back buffer as well
+    yy::parallel_write(buffer, std::vector<int>(5, 1), pool);
+    yy::parallel_write(buffer, std::vector<int>(3, 2), pool);
+    EXPECT_EQ(buffer.read(), std::vector<int>(3, 2));
+}
+
+TEST(ParallelCopyTests, NonTrivialElements) {
+    yy::CopyPool pool(2);
+    std::vector<std::string> next(10000);
+    for (std::size_t i = 0; i < next.size(); ++i) next[i] = std::to_string(i);
+
+    std::vector<std::string> dst;
+    yy::parallel_assign(dst, next, pool, 256);
+    EXPECT_EQ(dst, next);
+}
+
+TEST(ParallelCopyTests, FixedSizeArray) {
+    yy::CopyPool pool(2);
+    auto src = std::make_unique<std::array<double, 100000>>();
+    std::iota(src->begin(), src->end(), 0.5);
+    auto dst = std::make_unique<std::array<double, 100000>>();
+    yy::parallel_assign(*dst, *src, pool, 4096);
+    EXPECT_EQ(*dst, *src);
+}
@@ -0,0 +1,78 @@
+#include "Publisher.hpp"
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(PublisherTests, InitialValue) {
+    yy::Publisher<std::string> publisher("init");
+    EXPECT_EQ(publisher.read(), "init");
+}
+
+TEST(PublisherTests, PublishAndUpdateInOrder) {
+    yy::Publisher<std::string> publisher("init");
+    publisher.publish("updated");
+    publisher.update([](std::string& s) { s += "!"; });
+    publisher.flush();
+    EXPECT_EQ(publisher.read(), "updated!");
+}
+
+TEST(PublisherTests, ConcurrentProducers) {
+    constexpr int kProducers = 8;
+    constexpr int kUpdatesPerProducer = 5000;
+    yy::Publisher<std::vector<int>> publisher(std::vector<int>(kProducers, 0));
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < kProducers; ++p) {
+        producers.emplace_back([&, p] {
+            for (int i = 0; i < kUpdatesPerProducer; ++i) {
+                publisher.update([p](std::vector<int>& counts) { ++counts[p]; });
+            }
+        });
+    }
+    for (auto& t : producers) t.join();
+    publisher.flush();
+
+    EXPECT_EQ(publisher.read(), std::vector<int>(kProducers, kUpdatesPerProducer));
+}
+
+TEST(PublisherTests, DestructorDrainsQueue) {
+    std::string last;
+    {
+        yy::Publisher<std::string> publisher("init");
+        for (int i = 0; i < 100; ++i) {
+            publisher.update([i](std::string& s) { s = std::to_string(i); });
+        }
+        publisher.update([&last](std::string& s) { last = s; });
+    }
+    EXPECT_EQ(last, "99");
+}
+
+TEST(PublisherTests, RebuildAsyncPublishesResult) {
+    yy::Publisher<std::vector<int>> publisher({1, 2, 3});
+    publisher.rebuild_async([](const std::vector<int>& current) {
+        std::vector<int> doubled;
+        for (int v : current) doubled.push_back(v * 2);
+        return doubled;
+    });
+    publisher.flush();
+    EXPECT_EQ(publisher.read(), (std::vector<int>{2, 4, 6}));
+}
+
+TEST(PublisherTests, RebuildAsyncCoalescesRequests) {
+    yy::Publisher<int> publisher(0);
+    std::atomic<int> builds{0};
+    for (int i = 1; i <= 50; ++i) {
+        publisher.rebuild_async([&builds, i](const int&) {
+            builds.fetch_add(1);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            return i;
+        });
+    }
+    publisher.flush();
+    EXPECT_EQ(publisher.read(), 50);
+    EXPECT_LT(builds.load(), 50);
+}
@@ -0,0 +1,85 @@
+#include "SharedDoubleBuffer.hpp"
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <csignal>
+#include <cstdint>
+#include <string>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+struct Config {
+    std::uint64_t values[16];
+    explicit Config(std::uint64_t v = 0) { std::fill_n(values, 16, v); }
+    bool consistent() const {
+        return std::all_of(values, values + 16, [&](std::uint64_t v) { return v == values[0]; });
+    }
+};
+
+std::string unique_name(const char* test) {
+    return "/yy_dbuf_" + std::string(test) + "_" + std::to_string(::getpid());
+}
+} // namespace
+
+TEST(SharedDoubleBufferTests, WriterAndReaderInOneProcess) {
+    const auto name = unique_name("basic");
+    auto writer = yy::SharedDoubleBuffer<Config>::create(name, Config(1));
+    auto reader = yy::SharedDoubleBuffer<Config>::open(name);
+    yy::SharedDoubleBuffer<Config>::unlink(name);
+
+    EXPECT_FALSE(reader.writable());
+    EXPECT_EQ(reader.read().values[0], 1u);
+    writer.write(Config(2));
+    EXPECT_EQ(reader.read().values[15], 2u);
+    EXPECT_EQ(reader.generation(), 1u);
+}
+
+TEST(SharedDoubleBufferTests, ReaderProcessSeesConsistentValues) {
+    constexpr std::uint64_t kLast = 20000;
+    auto writer = yy::SharedDoubleBuffer<Config>::create_anonymous(Config(0));
+
+    const pid_t child = ::fork();
+    ASSERT_GE(child, 0);
+    if (child == 0) {
+        auto reader = yy::SharedDoubleBuffer<Config>::attach(writer.fd());
+        while (true) {
+            const Config c = reader.read();
+            if (!c.consistent()) ::_exit(1);
+            if (c.values[0] == kLast) ::_exit(0);
+        }
+    }
+
+    for (std::uint64_t i = 1; i <= kLast; ++i) {
+        writer.write(Config(i));
+    }
+    int status = 0;
+    ASSERT_EQ(::waitpid(child, &status, 0), child);
+    ASSERT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), 0);
+}
+
+TEST(SharedDoubleBufferTests, CrashedReaderDoesNotBlockWriter) {
+    auto writer = yy::SharedDoubleBuffer<Config>::create_anonymous(Config(0));
+
+    const pid_t child = ::fork();
+    ASSERT_GE(child, 0);
+    if (child == 0) {
+        auto reader = yy::SharedDoubleBuffer<Config>::attach(writer.fd());
+        while (true) reader.read();
+    }
+    ::usleep(10000);
+    ::kill(child, SIGKILL);
+    ::waitpid(child, nullptr, 0);
+
+    for (std::uint64_t i = 1; i <= 100; ++i) {
+        writer.write(Config(i));
+    }
+    auto reader = yy::SharedDoubleBuffer<Config>::attach(writer.fd());
+    EXPECT_EQ(reader.read().values[7], 100u);
+}
+
+TEST(SharedDoubleBufferTests, OpenRejectsMissingBuffer) {
+    EXPECT_THROW(yy::SharedDoubleBuffer<Config>::open(unique_name("missing")), std::system_error);
+}
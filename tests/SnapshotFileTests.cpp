@@ -0,0 +1,51 @@
+#include "SnapshotFile.hpp"
+
+#include <gtest/gtest.h>
+#include <array>
+#include <cstdio>
+#include <memory>
+#include <numeric>
+#include <string>
+
+#include <unistd.h>
+
+namespace {
+using Prices = std::array<double, 4096>;
+
+std::string temp_path(const char* test) {
+    return ::testing::TempDir() + "yy_snapshot_" + test + "_" + std::to_string(::getpid());
+}
+} // namespace
+
+TEST(SnapshotFileTests, WarmRestartFromMappedImage) {
+    const auto path = temp_path("restart");
+    auto prices = std::make_unique<Prices>();
+    std::iota(prices->begin(), prices->end(), 1.0);
+    {
+        yy::DoubleBuffer<Prices> published(*prices);
+        yy::save_snapshot(published, path);
+    }
+
+    // "Restart": construct straight from the mapped image
+    auto mapped = yy::MappedSnapshot<Prices>::open(path);
+    yy::DoubleBuffer<Prices> restored(*mapped);
+    EXPECT_EQ(restored.visit([](const Prices& p) { return p[4095]; }), 4096.0);
+    EXPECT_TRUE(mapped.validate());
+    std::remove(path.c_str());
+}
+
+TEST(SnapshotFileTests, DetectsWrongTypeAndCorruption) {
+    const auto path = temp_path("corrupt");
+    yy::save_snapshot(Prices{}, path);
+    using Other = std::array<float, 3>;
+    EXPECT_THROW(yy::MappedSnapshot<Other>::open(path), std::runtime_error);
+
+    // Flip one byte of the image
+    std::FILE* f = std::fopen(path.c_str(), "r+b");
+    ASSERT_NE(f, nullptr);
+    std::fseek(f, 4096 + 100, SEEK_SET);
+    std::fputc(0x5a, f);
+    std::fclose(f);
+    EXPECT_FALSE(yy::MappedSnapshot<Prices>::open(path).validate());
+    std::remove(path.c_str());
+}
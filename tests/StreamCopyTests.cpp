@@ -0,0 +1,42 @@
+#include <gtest/gtest.h>
+#include <DoubleBuffer.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <numeric>
+#include <vector>
+
+TEST(StreamCopyTests, CopiesAnySizeAndAlignment) {
+    std::vector<unsigned char> src(5000);
+    std::iota(src.begin(), src.end(), 0);
+    for (std::size_t dst_offset : {0u, 1u, 15u, 33u, 64u}) {
+        for (std::size_t src_offset : {0u, 3u, 32u}) {
+            for (std::size_t bytes : {0u, 1u, 63u, 64u, 255u, 256u, 1000u, 4900u}) {
+                std::vector<unsigned char> dst(5100, 0xee);
+                yy::stream_copy(dst.data() + dst_offset, src.data() + src_offset, bytes);
+                ASSERT_EQ(std::memcmp(dst.data() + dst_offset, src.data() + src_offset, bytes), 0)
+                    << dst_offset << " " << src_offset << " " << bytes;
+                ASSERT_EQ(dst[dst_offset + bytes], 0xee);
+                if (dst_offset > 0) {
+                    ASSERT_EQ(dst[dst_offset - 1], 0xee);
+                }
+            }
+        }
+    }
+}
+
+TEST(StreamCopyTests, LargeValuesPublishThroughStreamCopy) {
+    using Table = std::array<int, 2 * yy::kStreamCopyThreshold / sizeof(int)>;
+    static_assert(sizeof(Table) >= yy::kStreamCopyThreshold);
+
+    auto value = std::make_unique<Table>();
+    std::iota(value->begin(), value->end(), 0);
+    auto buffer = std::make_unique<yy::DoubleBuffer<Table>>(*value);
+    for (int i = 0; i < 3; ++i) {
+        (*value)[i * 1000] = -i;
+        buffer->write(*value);
+        EXPECT_TRUE(buffer->visit([&](const Table& t) { return t == *value; }));
+    }
+}